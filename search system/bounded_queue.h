@@ -0,0 +1,77 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+
+// Queue between two pipeline stages. A producer that gets ahead blocks once capacity items wait,
+// so a slow stage holds the faster ones back instead of letting the queue grow.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity);
+
+    // Blocks while the queue is full, false if the queue is closed
+    bool Push(T value);
+
+    // Blocks while the queue is empty and open, nothing once it is closed and drained
+    std::optional<T> Pop();
+
+    // Later pushes fail, waiting threads wake up and the items already queued can still be popped
+    void Close();
+
+private:
+    size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity)
+    : capacity_(capacity == 0 ? 1 : capacity) {
+}
+
+template <typename T>
+bool BoundedQueue<T>::Push(T value) {
+    std::unique_lock lock(mutex_);
+    not_full_.wait(lock, [this] {
+        return closed_ || items_.size() < capacity_;
+    });
+    if (closed_) {
+        return false;
+    }
+    items_.push_back(std::move(value));
+    not_empty_.notify_one();
+    return true;
+}
+
+template <typename T>
+std::optional<T> BoundedQueue<T>::Pop() {
+    std::unique_lock lock(mutex_);
+    not_empty_.wait(lock, [this] {
+        return closed_ || !items_.empty();
+    });
+    if (items_.empty()) {
+        return std::nullopt;
+    }
+    T value = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return value;
+}
+
+template <typename T>
+void BoundedQueue<T>::Close() {
+    {
+        std::lock_guard guard(mutex_);
+        closed_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+}
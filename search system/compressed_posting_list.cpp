@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <string>
+
+#include "compressed_posting_list.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define POSTINGS_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace std::string_literals;
+
+
+namespace {
+
+    const size_t LANE_COUNT = 4;
+    const size_t ROW_COUNT = CompressedPostingList::BLOCK_SIZE / LANE_COUNT;
+
+    uint32_t BitWidth(uint32_t value) {
+        uint32_t width = 0;
+        while (value != 0) {
+            ++width;
+            value >>= 1;
+        }
+        return width;
+    }
+
+    // Every lane packs its ROW_COUNT values into bit_width words, words of the lanes are interleaved
+    void PackBlock(const uint32_t* values, uint32_t bit_width, uint32_t* out) {
+        for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            uint64_t buffer = 0;
+            uint32_t buffered_bits = 0;
+            size_t word = 0;
+            for (size_t row = 0; row < ROW_COUNT; ++row) {
+                buffer |= static_cast<uint64_t>(values[row * LANE_COUNT + lane]) << buffered_bits;
+                buffered_bits += bit_width;
+                if (buffered_bits >= 32) {
+                    out[word * LANE_COUNT + lane] = static_cast<uint32_t>(buffer);
+                    buffer >>= 32;
+                    buffered_bits -= 32;
+                    ++word;
+                }
+            }
+        }
+    }
+
+#ifdef POSTINGS_USE_SSE2
+    // Unpacks the deltas of four lanes at once and turns them into ids with a vector prefix sum
+    void UnpackBlock(const uint32_t* packed, uint32_t bit_width, int first_document_id, int* out) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(packed);
+        const __m128i mask = _mm_set1_epi32(bit_width == 32 ? -1 : static_cast<int>((1u << bit_width) - 1));
+        __m128i current = bit_width == 0 ? _mm_setzero_si128() : _mm_loadu_si128(in);
+        __m128i previous = _mm_set1_epi32(first_document_id);
+        uint32_t shift = 0;
+        uint32_t word = 0;
+        for (size_t row = 0; row < ROW_COUNT; ++row) {
+            __m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(shift));
+            shift += bit_width;
+            if (shift >= 32) {
+                shift -= 32;
+                ++word;
+                if (word < bit_width) {
+                    current = _mm_loadu_si128(in + word);
+                    if (shift > 0) {
+                        value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128(bit_width - shift)));
+                    }
+                }
+            }
+            value = _mm_and_si128(value, mask);
+            value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+            value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+            value = _mm_add_epi32(value, previous);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + row * LANE_COUNT), value);
+            previous = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+    }
+#else
+    void UnpackBlock(const uint32_t* packed, uint32_t bit_width, int first_document_id, int* out) {
+        const uint64_t mask = (uint64_t{ 1 } << bit_width) - 1;
+        uint32_t deltas[CompressedPostingList::BLOCK_SIZE];
+        for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            uint64_t buffer = 0;
+            uint32_t buffered_bits = 0;
+            size_t word = 0;
+            for (size_t row = 0; row < ROW_COUNT; ++row) {
+                if (buffered_bits < bit_width) {
+                    buffer |= static_cast<uint64_t>(packed[word * LANE_COUNT + lane]) << buffered_bits;
+                    buffered_bits += 32;
+                    ++word;
+                }
+                deltas[row * LANE_COUNT + lane] = static_cast<uint32_t>(buffer & mask);
+                buffer >>= bit_width;
+                buffered_bits -= bit_width;
+            }
+        }
+        uint32_t document_id = static_cast<uint32_t>(first_document_id);
+        for (size_t i = 0; i < CompressedPostingList::BLOCK_SIZE; ++i) {
+            document_id += deltas[i];
+            out[i] = static_cast<int>(document_id);
+        }
+    }
+#endif
+
+}
+
+
+static_assert(CompressedPostingList::BLOCK_SIZE % TermFreqMaxima::RANGE_SIZE == 0, "TF ranges must not cross blocks");
+
+void CompressedPostingList::AppendTo(Columns& columns) const {
+    columns.blocks.insert(columns.blocks.end(), blocks_.begin(), blocks_.end());
+    columns.packed.insert(columns.packed.end(), packed_.begin(), packed_.end());
+    columns.tails.insert(columns.tails.end(), tail_.begin(), tail_.end());
+    columns.term_freqs.insert(columns.term_freqs.end(), term_freqs_.begin(), term_freqs_.end());
+    const auto& maxima = max_term_freqs_.GetMaxima();
+    columns.max_term_freqs.insert(columns.max_term_freqs.end(), maxima.begin(), maxima.end());
+}
+
+CompressedPostingList CompressedPostingList::View(const Columns& columns, size_t size, ColumnPosition& position) {
+    const auto fits = [](const auto& column, size_t pos, size_t count) {
+        return pos <= column.size() && column.size() - pos >= count;
+    };
+    const size_t block_count = size / BLOCK_SIZE;
+    if (!fits(columns.blocks, position.blocks, block_count)) {
+        throw std::out_of_range("Posting columns end before the list"s);
+    }
+    // Blocks are packed one after another, so the last one ends the packed words of the list
+    size_t packed_count = 0;
+    if (block_count > 0) {
+        const Block& last = columns.blocks[position.blocks + block_count - 1];
+        packed_count = static_cast<size_t>(last.offset) + LANE_COUNT * last.bit_width;
+    }
+    const size_t tail_count = size % BLOCK_SIZE;
+    const size_t range_count = TermFreqMaxima::GetRangeCount(size);
+    if (!fits(columns.packed, position.packed, packed_count) || !fits(columns.tails, position.tails, tail_count)
+        || !fits(columns.term_freqs, position.postings, size) || !fits(columns.max_term_freqs, position.max_term_freqs, range_count)) {
+        throw std::out_of_range("Posting columns end before the list"s);
+    }
+
+    CompressedPostingList postings;
+    postings.blocks_ = MappedVector<Block>::View(columns.blocks.data() + position.blocks, block_count);
+    postings.packed_ = MappedVector<uint32_t>::View(columns.packed.data() + position.packed, packed_count);
+    postings.tail_ = MappedVector<int>::View(columns.tails.data() + position.tails, tail_count);
+    postings.term_freqs_ = MappedVector<TermFreqCodec::Stored>::View(columns.term_freqs.data() + position.postings, size);
+    postings.max_term_freqs_ = TermFreqMaxima(MappedVector<TermFreqCodec::Stored>::View(
+        columns.max_term_freqs.data() + position.max_term_freqs, range_count));
+    position.blocks += block_count;
+    position.packed += packed_count;
+    position.tails += tail_count;
+    position.postings += size;
+    position.max_term_freqs += range_count;
+    return postings;
+}
+
+void CompressedPostingList::Add(int document_id, double term_freq) {
+    if (empty() || (tail_.empty() ? blocks_.back().last_document_id : tail_.back()) < document_id) {
+        tail_.push_back(document_id);
+        term_freqs_.push_back(TermFreqCodec::Encode(term_freq));
+        max_term_freqs_.Update(term_freqs_, term_freqs_.size() - 1);
+        if (tail_.size() == BLOCK_SIZE) {
+            AppendBlock(tail_.data());
+            tail_.clear();
+        }
+        return;
+    }
+    const size_t pos = Find(document_id);
+    if (pos < size()) {
+        term_freqs_[pos] = TermFreqCodec::Encode(TermFreqCodec::Decode(term_freqs_[pos]) + term_freq);
+        max_term_freqs_.Update(term_freqs_, pos);
+        return;
+    }
+    // Out of order insertion is rare, so the whole list is simply packed again
+    std::vector<int> document_ids = DecodeAll();
+    const size_t insert_pos = std::lower_bound(document_ids.begin(), document_ids.end(), document_id) - document_ids.begin();
+    document_ids.insert(document_ids.begin() + insert_pos, document_id);
+    term_freqs_.insert(term_freqs_.begin() + insert_pos, TermFreqCodec::Encode(term_freq));
+    max_term_freqs_.Rebuild(term_freqs_, insert_pos);
+    Rebuild(document_ids);
+}
+
+bool CompressedPostingList::Erase(int document_id) {
+    const size_t pos = Find(document_id);
+    if (pos == size()) {
+        return false;
+    }
+    std::vector<int> document_ids = DecodeAll();
+    document_ids.erase(document_ids.begin() + pos);
+    term_freqs_.erase(term_freqs_.begin() + pos);
+    max_term_freqs_.Rebuild(term_freqs_, pos);
+    Rebuild(document_ids);
+    return true;
+}
+
+size_t CompressedPostingList::Erase(const DocumentBitmap& documents) {
+    std::vector<int> document_ids = DecodeAll();
+    size_t kept = 0;
+    size_t first_erased = document_ids.size();
+    for (size_t pos = 0; pos < document_ids.size(); ++pos) {
+        if (documents.Test(document_ids[pos])) {
+            first_erased = std::min(first_erased, pos);
+            continue;
+        }
+        document_ids[kept] = document_ids[pos];
+        term_freqs_[kept] = term_freqs_[pos];
+        ++kept;
+    }
+    const size_t erased = document_ids.size() - kept;
+    if (erased > 0) {
+        document_ids.resize(kept);
+        term_freqs_.resize(kept);
+        max_term_freqs_.Rebuild(term_freqs_, first_erased);
+        Rebuild(document_ids);
+    }
+    return erased;
+}
+
+bool CompressedPostingList::Contains(int document_id) const {
+    return Find(document_id) < size();
+}
+
+double CompressedPostingList::GetTermFreq(int document_id) const {
+    const size_t pos = Find(document_id);
+    return pos < size() ? TermFreqCodec::Decode(term_freqs_[pos]) : 0.0;
+}
+
+bool CompressedPostingList::HasValidDocumentIds(int end_document_id) const {
+    int previous_document_id = -1;
+    const auto ascend = [&previous_document_id, end_document_id](const int* first, const int* last) {
+        for (const int* it = first; it != last; ++it) {
+            if (*it <= previous_document_id || *it >= end_document_id) {
+                return false;
+            }
+            previous_document_id = *it;
+        }
+        return true;
+    };
+    alignas(16) int document_ids[BLOCK_SIZE];
+    for (const Block& block : blocks_) {
+        // The packed words of a block must lie in the list before the block is decoded
+        if (block.bit_width > 32 || block.offset > packed_.size() || packed_.size() - block.offset < LANE_COUNT * block.bit_width) {
+            return false;
+        }
+        DecodeBlock(block, document_ids);
+        if (document_ids[0] != block.first_document_id || document_ids[BLOCK_SIZE - 1] != block.last_document_id
+            || !ascend(document_ids, document_ids + BLOCK_SIZE)) {
+            return false;
+        }
+    }
+    return ascend(tail_.begin(), tail_.end());
+}
+
+double CompressedPostingList::GetMaxTermFreq() const {
+    return max_term_freqs_.Get(0, TermFreqMaxima::GetRangeCount(size()));
+}
+
+size_t CompressedPostingList::size() const {
+    return term_freqs_.size();
+}
+
+bool CompressedPostingList::empty() const {
+    return term_freqs_.empty();
+}
+
+void CompressedPostingList::DecodeBlock(const Block& block, int* out) const {
+    UnpackBlock(packed_.data() + block.offset, block.bit_width, block.first_document_id, out);
+}
+
+void CompressedPostingList::AppendBlock(const int* document_ids) {
+    uint32_t deltas[BLOCK_SIZE];
+    uint32_t max_delta = 0;
+    deltas[0] = 0;
+    for (size_t i = 1; i < BLOCK_SIZE; ++i) {
+        deltas[i] = static_cast<uint32_t>(document_ids[i] - document_ids[i - 1]);
+        max_delta = std::max(max_delta, deltas[i]);
+    }
+    const uint32_t bit_width = BitWidth(max_delta);
+    const uint32_t offset = static_cast<uint32_t>(packed_.size());
+    blocks_.push_back({ document_ids[0], document_ids[BLOCK_SIZE - 1], offset, bit_width });
+    packed_.resize(packed_.size() + LANE_COUNT * bit_width);
+    PackBlock(deltas, bit_width, packed_.data() + offset);
+}
+
+std::vector<int> CompressedPostingList::DecodeAll() const {
+    std::vector<int> document_ids(blocks_.size() * BLOCK_SIZE);
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        DecodeBlock(blocks_[i], document_ids.data() + i * BLOCK_SIZE);
+    }
+    document_ids.insert(document_ids.end(), tail_.begin(), tail_.end());
+    return document_ids;
+}
+
+void CompressedPostingList::Rebuild(const std::vector<int>& document_ids) {
+    blocks_.clear();
+    packed_.clear();
+    tail_.clear();
+    const size_t full_size = document_ids.size() - document_ids.size() % BLOCK_SIZE;
+    for (size_t i = 0; i < full_size; i += BLOCK_SIZE) {
+        AppendBlock(document_ids.data() + i);
+    }
+    tail_.assign(document_ids.begin() + full_size, document_ids.end());
+}
+
+size_t CompressedPostingList::Find(int document_id) const {
+    const auto block_it = std::lower_bound(blocks_.begin(), blocks_.end(), document_id,
+        [](const Block& block, int id) {
+            return block.last_document_id < id;
+        });
+    if (block_it != blocks_.end()) {
+        if (document_id < block_it->first_document_id) {
+            return size();
+        }
+        alignas(16) int block_ids[BLOCK_SIZE];
+        DecodeBlock(*block_it, block_ids);
+        const int* it = std::lower_bound(block_ids, block_ids + BLOCK_SIZE, document_id);
+        if (*it != document_id) {
+            return size();
+        }
+        return (block_it - blocks_.begin()) * BLOCK_SIZE + (it - block_ids);
+    }
+    const auto it = std::lower_bound(tail_.begin(), tail_.end(), document_id);
+    if (it == tail_.end() || *it != document_id) {
+        return size();
+    }
+    return blocks_.size() * BLOCK_SIZE + (it - tail_.begin());
+}
+
+
+CompressedPostingList::Cursor::Cursor(const CompressedPostingList& postings)
+    : postings_(&postings) {
+    LoadBlock(0);
+}
+
+bool CompressedPostingList::Cursor::AtEnd() const {
+    return index_ == count_;
+}
+
+int CompressedPostingList::Cursor::GetDocumentId() const {
+    return GetDocumentIds()[index_];
+}
+
+double CompressedPostingList::Cursor::GetTermFreq() const {
+    return TermFreqCodec::Decode(postings_->term_freqs_[block_ * BLOCK_SIZE + index_]);
+}
+
+void CompressedPostingList::Cursor::Next() {
+    ++index_;
+    if (index_ == count_ && block_ < postings_->blocks_.size()) {
+        LoadBlock(block_ + 1);
+    }
+}
+
+void CompressedPostingList::Cursor::Advance(int document_id) {
+    if (AtEnd() || document_id <= GetDocumentId()) {
+        return;
+    }
+    const size_t block = FindBlock(document_id);
+    if (block != block_) {
+        LoadBlock(block);
+    }
+    const int* document_ids = GetDocumentIds();
+    index_ = std::lower_bound(document_ids + index_, document_ids + count_, document_id) - document_ids;
+}
+
+PostingBlockBound CompressedPostingList::Cursor::GetBlockBound(int document_id) const {
+    const size_t block = FindBlock(document_id);
+    const auto& blocks = postings_->blocks_;
+    const size_t ranges_per_block = BLOCK_SIZE / TermFreqMaxima::RANGE_SIZE;
+    if (block != block_ && block < blocks.size()) {
+        return { blocks[block].last_document_id,
+            postings_->max_term_freqs_.Get(block * ranges_per_block, (block + 1) * ranges_per_block) };
+    }
+    const int* document_ids = block == block_ ? GetDocumentIds() : postings_->tail_.data();
+    const size_t count = block < blocks.size() ? BLOCK_SIZE : postings_->tail_.size();
+    const size_t first = block == block_ ? index_ : 0;
+    const size_t index = std::lower_bound(document_ids + first, document_ids + count, document_id) - document_ids;
+    if (index == count) {
+        return {};
+    }
+    const size_t range_end = std::min(count, (index / TermFreqMaxima::RANGE_SIZE + 1) * TermFreqMaxima::RANGE_SIZE);
+    return { document_ids[range_end - 1], postings_->max_term_freqs_.Get((block * BLOCK_SIZE + index) / TermFreqMaxima::RANGE_SIZE) };
+}
+
+void CompressedPostingList::Cursor::LoadBlock(size_t block) {
+    block_ = block;
+    index_ = 0;
+    if (block < postings_->blocks_.size()) {
+        postings_->DecodeBlock(postings_->blocks_[block], decoded_);
+        count_ = BLOCK_SIZE;
+    }
+    else {
+        count_ = postings_->tail_.size();
+    }
+}
+
+const int* CompressedPostingList::Cursor::GetDocumentIds() const {
+    return block_ < postings_->blocks_.size() ? decoded_ : postings_->tail_.data();
+}
+
+size_t CompressedPostingList::Cursor::FindBlock(int document_id) const {
+    const auto& blocks = postings_->blocks_;
+    if (block_ == blocks.size() || document_id <= blocks[block_].last_document_id) {
+        return block_;
+    }
+    return std::lower_bound(blocks.begin() + block_ + 1, blocks.end(), document_id,
+        [](const Block& block, int id) {
+            return block.last_document_id < id;
+        }) - blocks.begin();
+}
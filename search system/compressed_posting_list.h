@@ -0,0 +1,168 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "posting_list.h"
+#include "term_freq.h"
+#include "mapped_vector.h"
+
+
+// Postings of a single term with the same interface as PostingList, but document ids are
+// delta-encoded and bit-packed in blocks of BLOCK_SIZE. A block uses the SIMD-BP128 layout:
+// value i goes to 32-bit lane i % 4, so four lanes are unpacked by one SSE2 instruction.
+// Appended ids wait in an uncompressed tail until a whole block is collected.
+class CompressedPostingList {
+public:
+    static const size_t BLOCK_SIZE = 128;
+
+    // Document-at-a-time iteration that decodes one block at a time
+    class Cursor {
+    public:
+        explicit Cursor(const CompressedPostingList& postings);
+
+        bool AtEnd() const;
+        int GetDocumentId() const;
+        double GetTermFreq() const;
+        void Next();
+
+        // Moves to the first posting with id >= document_id, skipping whole blocks by their last id
+        void Advance(int document_id);
+
+        // Bound of the range holding the first posting with id >= document_id, the cursor does not move.
+        // Ranges of blocks that are not decoded yet are widened to the whole block.
+        PostingBlockBound GetBlockBound(int document_id) const;
+
+    private:
+        const CompressedPostingList* postings_;
+        // blocks_.size() stands for the uncompressed tail
+        size_t block_ = 0;
+        size_t index_ = 0;
+        size_t count_ = 0;
+        alignas(16) int decoded_[BLOCK_SIZE];
+
+        // Ids of the current block, cursors are copyable so this is not cached as a pointer
+        const int* GetDocumentIds() const;
+        void LoadBlock(size_t block);
+        // First block at or after the current one that may hold document_id
+        size_t FindBlock(int document_id) const;
+    };
+
+    // Packed ids of one block, offset counts from the first packed word of the list
+    struct Block {
+        int first_document_id;
+        int last_document_id;
+        // Index of the first packed word, the block takes 4 * bit_width words
+        uint32_t offset;
+        uint32_t bit_width;
+    };
+
+    // Arrays of many lists stored back to back, the way a snapshot keeps them
+    struct Columns {
+        MappedVector<Block> blocks;
+        MappedVector<uint32_t> packed;
+        MappedVector<int> tails;
+        MappedVector<TermFreqCodec::Stored> term_freqs;
+        MappedVector<TermFreqCodec::Stored> max_term_freqs;
+
+        // Calls function(column) for every column, always in the same order
+        template <typename Function>
+        void ForEach(Function function);
+        template <typename Function>
+        void ForEach(Function function) const;
+    };
+
+    // Where the next list starts in every column
+    struct ColumnPosition {
+        size_t blocks = 0;
+        size_t packed = 0;
+        size_t tails = 0;
+        size_t postings = 0;
+        size_t max_term_freqs = 0;
+    };
+
+    // Appends the arrays of the list to columns
+    void AppendTo(Columns& columns) const;
+
+    // List of size postings stored at position, which moves past it. The list views the memory of
+    // the columns, which must outlive it, and copies it only once it is changed.
+    // Throws std::out_of_range if the columns end before the list.
+    static CompressedPostingList View(const Columns& columns, size_t size, ColumnPosition& position);
+
+    // Adds term frequency of the document, keeping document ids sorted
+    void Add(int document_id, double term_freq);
+
+    // Returns false if the document is not in the list
+    bool Erase(int document_id);
+
+    // Removes the postings of every document set in documents in one pass, returns how many were removed
+    size_t Erase(const DocumentBitmap& documents);
+
+    bool Contains(int document_id) const;
+
+    // True if the document ids ascend and lie in [0, end_document_id), as they must in a list
+    // viewing columns read from a file before it is searched
+    bool HasValidDocumentIds(int end_document_id) const;
+
+    // Term frequency of the document or 0.0 if it is not in the list
+    double GetTermFreq(int document_id) const;
+
+    // The largest term frequency in the list
+    double GetMaxTermFreq() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    // Calls function(document_id, term_freq) for each posting in document id order
+    template <typename Function>
+    void ForEach(Function function) const;
+
+private:
+    MappedVector<Block> blocks_;
+    MappedVector<uint32_t> packed_;
+    MappedVector<int> tail_;
+    MappedVector<TermFreqCodec::Stored> term_freqs_;
+    TermFreqMaxima max_term_freqs_;
+
+    // Writes BLOCK_SIZE document ids of the block to out
+    void DecodeBlock(const Block& block, int* out) const;
+    void AppendBlock(const int* document_ids);
+    std::vector<int> DecodeAll() const;
+    void Rebuild(const std::vector<int>& document_ids);
+
+    // Position of the document in id order or size() if it is not in the list
+    size_t Find(int document_id) const;
+};
+
+template <typename Function>
+void CompressedPostingList::Columns::ForEach(Function function) {
+    function(blocks);
+    function(packed);
+    function(tails);
+    function(term_freqs);
+    function(max_term_freqs);
+}
+
+template <typename Function>
+void CompressedPostingList::Columns::ForEach(Function function) const {
+    function(blocks);
+    function(packed);
+    function(tails);
+    function(term_freqs);
+    function(max_term_freqs);
+}
+
+template <typename Function>
+void CompressedPostingList::ForEach(Function function) const {
+    alignas(16) int document_ids[BLOCK_SIZE];
+    size_t index = 0;
+    for (const Block& block : blocks_) {
+        DecodeBlock(block, document_ids);
+        for (size_t i = 0; i < BLOCK_SIZE; ++i, ++index) {
+            function(document_ids[i], TermFreqCodec::Decode(term_freqs_[index]));
+        }
+    }
+    for (int document_id : tail_) {
+        function(document_id, TermFreqCodec::Decode(term_freqs_[index++]));
+    }
+}
@@ -0,0 +1,54 @@
+#include <thread>
+
+#include "concurrent_search_server.h"
+
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ConcurrentSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return Read([raw_query, document_id](const SearchServer& server) {
+        return server.MatchDocument(raw_query, document_id);
+        });
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return Read([](const SearchServer& server) {
+        return server.GetDocumentCount();
+        });
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    Write([&](SearchServer& server) {
+        server.AddDocument(document_id, document, status, ratings);
+        });
+}
+
+void ConcurrentSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    Write([&documents](SearchServer& server) {
+        server.AddDocuments(std::execution::par, documents);
+        });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    Write([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+        });
+}
+
+void ConcurrentSearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    Write([&document_ids](SearchServer& server) {
+        server.RemoveDocuments(document_ids);
+        });
+}
+
+void ConcurrentSearchServer::WaitForReaders() {
+    const auto wait_until_empty = [this](int version_index) {
+        while (read_indicators_[version_index].readers.load() != 0) {
+            std::this_thread::yield();
+        }
+    };
+    // Readers that came before the switch of published_ may hold either copy. New readers go to the
+    // other indicator once it is drained, then the old indicator only loses readers.
+    const int version_index = version_index_.load();
+    wait_until_empty(1 - version_index);
+    version_index_.store(1 - version_index);
+    wait_until_empty(version_index);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "search_server.h"
+
+
+// SearchServer that takes writes while queries run on other threads, by the left-right technique.
+// Two copies of the index are kept. Readers pin the copy that is published at the moment and never
+// wait or lock. A writer changes the other copy, publishes it with an atomic store, waits until
+// the readers of the old copy leave and repeats the change there. Writers are serialized.
+// A write must be deterministic and must either succeed or leave the server unchanged, because
+// it is applied to each copy in turn. Batching documents into one write saves waiting for readers.
+class ConcurrentSearchServer {
+public:
+    template <typename... Args>
+    explicit ConcurrentSearchServer(const Args&... args);
+
+    // Calls read(const SearchServer&) on the published copy, which does not change until read returns
+    template <typename Reader>
+    auto Read(Reader read) const;
+
+    // Calls write(SearchServer&) once per copy and publishes the result as one version
+    template <typename Writer>
+    void Write(Writer write);
+
+    template <typename... Args>
+    std::vector<Document> FindTopDocuments(Args&&... args) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+    int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+    void RemoveDocument(int document_id);
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+private:
+    // Readers of one version index, on its own cache line so the two counters do not share one
+    struct alignas(64) ReadIndicator {
+        std::atomic<int64_t> readers{ 0 };
+    };
+
+    std::array<SearchServer, 2> servers_;
+    // Copy that readers use
+    std::atomic<int> published_{ 0 };
+    // Readers announce themselves in the indicator of this index, so a writer can tell which
+    // readers may still see the copy it is about to change
+    std::atomic<int> version_index_{ 0 };
+    mutable std::array<ReadIndicator, 2> read_indicators_;
+    std::mutex write_mutex_;
+
+    // Waits until no reader can be using the unpublished copy
+    void WaitForReaders();
+};
+
+template <typename... Args>
+ConcurrentSearchServer::ConcurrentSearchServer(const Args&... args)
+    : servers_{ SearchServer(args...), SearchServer(args...) } {
+}
+
+template <typename Reader>
+auto ConcurrentSearchServer::Read(Reader read) const {
+    const int version_index = version_index_.load();
+    ReadIndicator& indicator = read_indicators_[version_index];
+    indicator.readers.fetch_add(1);
+    // Leaves the indicator even if read throws
+    struct Departure {
+        ReadIndicator& indicator;
+        ~Departure() {
+            indicator.readers.fetch_sub(1);
+        }
+    } departure{ indicator };
+    return read(servers_[published_.load()]);
+}
+
+template <typename Writer>
+void ConcurrentSearchServer::Write(Writer write) {
+    std::lock_guard guard(write_mutex_);
+    const int published = published_.load();
+    write(servers_[1 - published]);
+    published_.store(1 - published);
+    WaitForReaders();
+    write(servers_[published]);
+}
+
+template <typename... Args>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(Args&&... args) const {
+    return Read([&args...](const SearchServer& server) {
+        return server.FindTopDocuments(std::forward<Args>(args)...);
+        });
+}
@@ -1,4 +1,17 @@
 #pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+
+enum class DocumentStatus {
+    ACTUAL,
+    IRRELEVANT,
+    BANNED,
+    REMOVED
+};
+
+const size_t DOCUMENT_STATUS_COUNT = static_cast<size_t>(DocumentStatus::REMOVED) + 1;
 
 
 struct Document {
@@ -8,4 +21,12 @@ struct Document {
     int id = 0;
     double relevance = 0.0;
     int rating = 0;
-};
\ No newline at end of file
+};
+
+// Arguments of one AddDocument call, for adding documents in batches
+struct DocumentInput {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
@@ -0,0 +1,103 @@
+#include "document_bitmap.h"
+
+#if defined(__AVX2__)
+#define BITMAP_USE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BITMAP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace {
+
+    // Bits of WORD_BITS consecutive values inside [min_value, max_value]
+    uint64_t ScanRangeWord(const int* values, int min_value, int max_value) {
+        uint64_t word = 0;
+#if defined(BITMAP_USE_AVX2)
+        const __m256i below = _mm256_set1_epi32(min_value);
+        const __m256i above = _mm256_set1_epi32(max_value);
+        for (int i = 0; i < 64; i += 8) {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            const __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(below, chunk), _mm256_cmpgt_epi32(chunk, above));
+            const uint64_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(outside)));
+            word |= (~mask & 0xFF) << i;
+        }
+#elif defined(BITMAP_USE_SSE2)
+        const __m128i below = _mm_set1_epi32(min_value);
+        const __m128i above = _mm_set1_epi32(max_value);
+        for (int i = 0; i < 64; i += 4) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+            const __m128i outside = _mm_or_si128(_mm_cmplt_epi32(chunk, below), _mm_cmpgt_epi32(chunk, above));
+            const uint64_t mask = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(outside)));
+            word |= (~mask & 0xF) << i;
+        }
+#else
+        for (int i = 0; i < 64; ++i) {
+            word |= static_cast<uint64_t>(min_value <= values[i] && values[i] <= max_value) << i;
+        }
+#endif
+        return word;
+    }
+
+}
+
+
+
+DocumentBitmap::DocumentBitmap(size_t size) {
+    Assign(size);
+}
+
+void DocumentBitmap::Assign(size_t size, bool value) {
+    words_.assign((size + WORD_BITS - 1) / WORD_BITS, value ? ~uint64_t{ 0 } : 0);
+    size_ = size;
+    if (value && size % WORD_BITS != 0) {
+        words_.back() = (uint64_t{ 1 } << (size % WORD_BITS)) - 1;
+    }
+}
+
+void DocumentBitmap::Resize(size_t size) {
+    words_.resize((size + WORD_BITS - 1) / WORD_BITS, 0);
+    size_ = size;
+}
+
+size_t DocumentBitmap::size() const {
+    return size_;
+}
+
+void DocumentBitmap::AssignRange(const int* values, int min_value, int max_value) {
+    const size_t full_words = size_ / WORD_BITS;
+    for (size_t i = 0; i < full_words; ++i) {
+        words_[i] = ScanRangeWord(values + i * WORD_BITS, min_value, max_value);
+    }
+    if (full_words < words_.size()) {
+        uint64_t word = 0;
+        for (size_t i = full_words * WORD_BITS; i < size_; ++i) {
+            word |= static_cast<uint64_t>(min_value <= values[i] && values[i] <= max_value) << (i % WORD_BITS);
+        }
+        words_.back() = word;
+    }
+}
+
+DocumentBitmap& DocumentBitmap::operator&=(const DocumentBitmap& other) {
+    for (size_t i = 0; i < words_.size(); ++i) {
+        words_[i] &= other.words_[i];
+    }
+    return *this;
+}
+
+DocumentBitmap& DocumentBitmap::operator|=(const DocumentBitmap& other) {
+    for (size_t i = 0; i < words_.size(); ++i) {
+        words_[i] |= other.words_[i];
+    }
+    return *this;
+}
+
+void DocumentBitmap::Flip() {
+    for (uint64_t& word : words_) {
+        word = ~word;
+    }
+    if (size_ % WORD_BITS != 0) {
+        words_.back() &= (uint64_t{ 1 } << (size_ % WORD_BITS)) - 1;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// One bit per document ordinal, packed in 64-bit words
+class DocumentBitmap {
+public:
+    DocumentBitmap() = default;
+    explicit DocumentBitmap(size_t size);
+
+    // Resizes the bitmap to size bits, all of them set to value
+    void Assign(size_t size, bool value = false);
+
+    // Keeps the existing bits, new ones are cleared
+    void Resize(size_t size);
+
+    void Set(int ordinal) {
+        words_[ordinal / WORD_BITS] |= uint64_t{ 1 } << (ordinal % WORD_BITS);
+    }
+
+    void Reset(int ordinal) {
+        words_[ordinal / WORD_BITS] &= ~(uint64_t{ 1 } << (ordinal % WORD_BITS));
+    }
+
+    bool Test(int ordinal) const {
+        return (words_[ordinal / WORD_BITS] >> (ordinal % WORD_BITS)) & 1;
+    }
+
+    // Bit i is set if min_value <= values[i] <= max_value, values holds size() elements
+    void AssignRange(const int* values, int min_value, int max_value);
+
+    // other must have the same size
+    DocumentBitmap& operator&=(const DocumentBitmap& other);
+    DocumentBitmap& operator|=(const DocumentBitmap& other);
+    void Flip();
+
+    size_t size() const;
+
+private:
+    static const int WORD_BITS = 64;
+
+    // Bits past size_ in the last word are always zero
+    std::vector<uint64_t> words_;
+    size_t size_ = 0;
+};
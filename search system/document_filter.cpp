@@ -0,0 +1,118 @@
+#include <climits>
+#include <utility>
+
+#include "document_filter.h"
+
+
+DocumentFilter::DocumentFilter(Kind kind, int min_value, int max_value)
+    : kind_(kind), min_value_(min_value), max_value_(max_value) {
+}
+
+DocumentFilter::DocumentFilter(Kind kind, std::vector<DocumentFilter> operands)
+    : kind_(kind), operands_(std::move(operands)) {
+}
+
+DocumentFilter DocumentFilter::RatingBetween(int min_rating, int max_rating) {
+    return DocumentFilter(Kind::RATING, min_rating, max_rating);
+}
+
+DocumentFilter DocumentFilter::RatingAtLeast(int min_rating) {
+    return DocumentFilter(Kind::RATING, min_rating, INT_MAX);
+}
+
+DocumentFilter DocumentFilter::IdBetween(int min_id, int max_id) {
+    return DocumentFilter(Kind::ID, min_id, max_id);
+}
+
+DocumentFilter DocumentFilter::StatusIn(std::initializer_list<DocumentStatus> statuses) {
+    DocumentFilter filter(Kind::STATUS, 0, 0);
+    for (DocumentStatus status : statuses) {
+        filter.status_mask_ |= 1u << static_cast<unsigned>(status);
+    }
+    return filter;
+}
+
+bool DocumentFilter::operator()(int document_id, DocumentStatus status, int rating) const {
+    switch (kind_) {
+    case Kind::RATING:
+        return min_value_ <= rating && rating <= max_value_;
+    case Kind::ID:
+        return min_value_ <= document_id && document_id <= max_value_;
+    case Kind::STATUS:
+        return (status_mask_ >> static_cast<unsigned>(status)) & 1u;
+    case Kind::AND:
+        for (const DocumentFilter& operand : operands_) {
+            if (!operand(document_id, status, rating)) {
+                return false;
+            }
+        }
+        return true;
+    case Kind::OR:
+        for (const DocumentFilter& operand : operands_) {
+            if (operand(document_id, status, rating)) {
+                return true;
+            }
+        }
+        return false;
+    case Kind::NOT:
+        return !operands_[0](document_id, status, rating);
+    default:
+        return true;
+    }
+}
+
+void DocumentFilter::Evaluate(const FilterColumns& columns, DocumentBitmap& candidates) const {
+    const size_t size = columns.ratings.size();
+    switch (kind_) {
+    case Kind::RATING:
+        candidates.Assign(size);
+        candidates.AssignRange(columns.ratings.data(), min_value_, max_value_);
+        break;
+    case Kind::ID:
+        candidates.Assign(size);
+        candidates.AssignRange(columns.document_ids.data(), min_value_, max_value_);
+        break;
+    case Kind::STATUS:
+        // Status sets are answered by the bitmaps the server already keeps
+        candidates.Assign(size);
+        for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            if ((status_mask_ >> status) & 1u) {
+                candidates |= columns.status_documents[status];
+            }
+        }
+        break;
+    case Kind::AND:
+    case Kind::OR: {
+        operands_[0].Evaluate(columns, candidates);
+        DocumentBitmap operand_candidates;
+        for (size_t i = 1; i < operands_.size(); ++i) {
+            operands_[i].Evaluate(columns, operand_candidates);
+            if (kind_ == Kind::AND) {
+                candidates &= operand_candidates;
+            }
+            else {
+                candidates |= operand_candidates;
+            }
+        }
+        break;
+    }
+    case Kind::NOT:
+        operands_[0].Evaluate(columns, candidates);
+        candidates.Flip();
+        break;
+    default:
+        candidates.Assign(size, true);
+    }
+}
+
+DocumentFilter operator&&(DocumentFilter lhs, DocumentFilter rhs) {
+    return DocumentFilter(DocumentFilter::Kind::AND, { std::move(lhs), std::move(rhs) });
+}
+
+DocumentFilter operator||(DocumentFilter lhs, DocumentFilter rhs) {
+    return DocumentFilter(DocumentFilter::Kind::OR, { std::move(lhs), std::move(rhs) });
+}
+
+DocumentFilter operator!(DocumentFilter filter) {
+    return DocumentFilter(DocumentFilter::Kind::NOT, { std::move(filter) });
+}
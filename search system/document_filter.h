@@ -0,0 +1,61 @@
+#pragma once
+#include <initializer_list>
+#include <vector>
+
+#include "document.h"
+#include "document_bitmap.h"
+#include "mapped_vector.h"
+
+
+// Metadata columns a filter is evaluated over, all indexed by document ordinal
+struct FilterColumns {
+    const MappedVector<int>& document_ids;
+    const MappedVector<int>& ratings;
+    // DOCUMENT_STATUS_COUNT bitmaps, one per status
+    const DocumentBitmap* status_documents;
+};
+
+// Declarative condition on document metadata. Unlike an opaque predicate it is evaluated once per
+// query by scanning whole columns, which gives the bitmap of documents that may be scored.
+class DocumentFilter {
+public:
+    // Passes every document
+    DocumentFilter() = default;
+
+    // Bounds are inclusive
+    static DocumentFilter RatingBetween(int min_rating, int max_rating);
+    static DocumentFilter RatingAtLeast(int min_rating);
+    static DocumentFilter IdBetween(int min_id, int max_id);
+    static DocumentFilter StatusIn(std::initializer_list<DocumentStatus> statuses);
+
+    // Checks a single document, so the filter can be used as a DocumentPredicate as well
+    bool operator()(int document_id, DocumentStatus status, int rating) const;
+
+    // Resizes candidates to the length of the columns and sets the bits of passing documents
+    void Evaluate(const FilterColumns& columns, DocumentBitmap& candidates) const;
+
+    friend DocumentFilter operator&&(DocumentFilter lhs, DocumentFilter rhs);
+    friend DocumentFilter operator||(DocumentFilter lhs, DocumentFilter rhs);
+    friend DocumentFilter operator!(DocumentFilter filter);
+
+private:
+    enum class Kind {
+        ANY,
+        RATING,
+        ID,
+        STATUS,
+        AND,
+        OR,
+        NOT
+    };
+
+    Kind kind_ = Kind::ANY;
+    int min_value_ = 0;
+    int max_value_ = 0;
+    // Bit i stands for static_cast<DocumentStatus>(i)
+    unsigned status_mask_ = 0;
+    std::vector<DocumentFilter> operands_;
+
+    DocumentFilter(Kind kind, int min_value, int max_value);
+    DocumentFilter(Kind kind, std::vector<DocumentFilter> operands);
+};
@@ -0,0 +1,83 @@
+#include <stdexcept>
+#include <string>
+
+#include "document_ids.h"
+
+using namespace std::string_literals;
+
+
+namespace {
+
+    const std::pmr::set<int> EMPTY_IDS;
+
+}
+
+
+DocumentIds::DocumentIds(const DocumentIds& other) {
+    if (!other.nodes_) {
+        return;
+    }
+    nodes_ = std::make_unique<Nodes>();
+    nodes_->ids.insert(other.nodes_->ids.begin(), other.nodes_->ids.end());
+    nodes_->ordinals.reserve(other.nodes_->ordinals.size());
+    nodes_->ordinals.insert(other.nodes_->ordinals.begin(), other.nodes_->ordinals.end());
+}
+
+DocumentIds& DocumentIds::operator=(const DocumentIds& other) {
+    if (this != &other) {
+        DocumentIds copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+bool DocumentIds::Add(int document_id, int ordinal) {
+    if (!nodes_) {
+        nodes_ = std::make_unique<Nodes>();
+    }
+    if (!nodes_->ordinals.emplace(document_id, ordinal).second) {
+        return false;
+    }
+    nodes_->ids.insert(document_id);
+    return true;
+}
+
+bool DocumentIds::Remove(int document_id) {
+    if (!nodes_ || nodes_->ordinals.erase(document_id) == 0) {
+        return false;
+    }
+    nodes_->ids.erase(document_id);
+    return true;
+}
+
+int DocumentIds::Find(int document_id) const {
+    if (!nodes_) {
+        return NO_ORDINAL;
+    }
+    const auto it = nodes_->ordinals.find(document_id);
+    return it == nodes_->ordinals.end() ? NO_ORDINAL : it->second;
+}
+
+int DocumentIds::At(int document_id) const {
+    const int ordinal = Find(document_id);
+    if (ordinal == NO_ORDINAL) {
+        throw std::out_of_range("No document with id "s + std::to_string(document_id));
+    }
+    return ordinal;
+}
+
+bool DocumentIds::Contains(int document_id) const {
+    return Find(document_id) != NO_ORDINAL;
+}
+
+size_t DocumentIds::size() const {
+    return nodes_ ? nodes_->ordinals.size() : 0;
+}
+
+DocumentIds::const_iterator DocumentIds::begin() const {
+    return nodes_ ? nodes_->ids.begin() : EMPTY_IDS.begin();
+}
+
+DocumentIds::const_iterator DocumentIds::end() const {
+    return nodes_ ? nodes_->ids.end() : EMPTY_IDS.end();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <unordered_map>
+
+
+// Ids of the documents of a server with their ordinals. Both containers allocate their nodes from a
+// pool of their own instead of one heap block per node, so adding documents takes memory in large
+// chunks and the pool returns it at once. A copy gets a pool of its own, moves take the pool along.
+// Nothing is allocated before the first id is added, the moved-from object is empty.
+class DocumentIds {
+public:
+    using const_iterator = std::pmr::set<int>::const_iterator;
+
+    static constexpr int NO_ORDINAL = -1;
+
+    DocumentIds() = default;
+    DocumentIds(const DocumentIds& other);
+    DocumentIds& operator=(const DocumentIds& other);
+    DocumentIds(DocumentIds&&) noexcept = default;
+    DocumentIds& operator=(DocumentIds&&) noexcept = default;
+
+    // False if the id is already there
+    bool Add(int document_id, int ordinal);
+    // False if there is no such id
+    bool Remove(int document_id);
+
+    // NO_ORDINAL if there is no such id
+    int Find(int document_id) const;
+    // Throws std::out_of_range if there is no such id
+    int At(int document_id) const;
+    bool Contains(int document_id) const;
+
+    size_t size() const;
+
+    // Ids in ascending order
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    // The pool is declared first, so the containers release their nodes before it goes away
+    struct Nodes {
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::set<int> ids{ &pool };
+        std::pmr::unordered_map<int, int> ordinals{ &pool };
+    };
+
+    // Held by pointer, so a move does not change the resource the containers allocate from
+    std::unique_ptr<Nodes> nodes_;
+};
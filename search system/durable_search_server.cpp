@@ -0,0 +1,73 @@
+#include <execution>
+
+#include "durable_search_server.h"
+
+
+void DurableSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    server_.CheckDocument(document_id, document);
+    log_.AppendAddDocument(document_id, document, status, ratings);
+    server_.AddDocument(document_id, document, status, ratings);
+}
+
+void DurableSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    server_.CheckDocuments(documents);
+    for (const DocumentInput& document : documents) {
+        log_.AppendAddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    server_.AddDocuments(std::execution::par, documents);
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+    log_.AppendRemoveDocument(document_id);
+    server_.RemoveDocument(document_id);
+}
+
+void DurableSearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    for (int document_id : document_ids) {
+        log_.AppendRemoveDocument(document_id);
+    }
+    server_.RemoveDocuments(document_ids);
+}
+
+void DurableSearchServer::Sync() {
+    log_.Sync();
+}
+
+void DurableSearchServer::Checkpoint() {
+    // SaveSnapshot returns once the new snapshot and its name are synced, so the log is only cut
+    // after the snapshot that holds its records would survive a crash of the machine
+    server_.SaveSnapshot(snapshot_path_);
+    log_.Truncate();
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> DurableSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return server_.MatchDocument(raw_query, document_id);
+}
+
+int DurableSearchServer::GetDocumentCount() const {
+    return server_.GetDocumentCount();
+}
+
+const SearchServer& DurableSearchServer::GetServer() const {
+    return server_;
+}
+
+size_t DurableSearchServer::GetReplayedCount() const {
+    return replayed_count_;
+}
+
+void DurableSearchServer::Replay() {
+    replayed_count_ = log_.Replay([this](const LogRecord& record) {
+        if (record.type == LogRecordType::REMOVE_DOCUMENT) {
+            server_.RemoveDocument(record.document_id);
+            return;
+        }
+        // After a crash between the two steps of Checkpoint the new snapshot already holds the
+        // documents of the old log. Replacing the document makes replaying such a record harmless:
+        // the last logged write of every id still decides what the server holds.
+        if (server_.HasDocument(record.document_id)) {
+            server_.RemoveDocument(record.document_id);
+        }
+        server_.AddDocument(record.document_id, record.text, record.status, record.ratings);
+        });
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+
+// SearchServer whose mutations survive a crash. Every write is appended to a write-ahead log before
+// it is applied, Checkpoint saves a snapshot and empties the log, and the constructor loads the last
+// snapshot and replays the log on top of it. Documents are checked before they are logged, so a
+// rejected document never reaches the log and replay does not fail.
+// A write returns once it is logged in memory. The log writes it with its group or at most
+// WriteAheadLogOptions::max_delay later, and Sync is the durability point: a write acknowledged
+// after Sync returns survives a crash of the machine.
+class DurableSearchServer {
+public:
+    // Stop words are only used when there is no snapshot yet, otherwise they come from the snapshot
+    template <typename StopWords>
+    DurableSearchServer(const std::string& snapshot_path, const std::string& log_path, const StopWords& stop_words,
+        WriteAheadLogOptions options = {});
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+    void RemoveDocument(int document_id);
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // Blocks until every earlier write is written and synced to the log
+    void Sync();
+    // Saves and syncs a snapshot of the server, then truncates the log
+    void Checkpoint();
+
+    template <typename... Args>
+    std::vector<Document> FindTopDocuments(Args&&... args) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+    int GetDocumentCount() const;
+
+    const SearchServer& GetServer() const;
+    // Log records applied by the constructor
+    size_t GetReplayedCount() const;
+
+private:
+    std::string snapshot_path_;
+    SearchServer server_;
+    WriteAheadLog log_;
+    size_t replayed_count_ = 0;
+
+    void Replay();
+};
+
+template <typename StopWords>
+DurableSearchServer::DurableSearchServer(const std::string& snapshot_path, const std::string& log_path, const StopWords& stop_words,
+    WriteAheadLogOptions options)
+    : snapshot_path_(snapshot_path)
+    , server_(std::filesystem::exists(snapshot_path) ? SearchServer::LoadSnapshot(snapshot_path) : SearchServer(stop_words))
+    , log_(log_path, options) {
+    Replay();
+}
+
+template <typename... Args>
+std::vector<Document> DurableSearchServer::FindTopDocuments(Args&&... args) const {
+    return server_.FindTopDocuments(std::forward<Args>(args)...);
+}
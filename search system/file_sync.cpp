@@ -0,0 +1,65 @@
+#include <mutex>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "file_sync.h"
+
+
+namespace {
+
+    // Syncs run on the flusher threads of logs too, so the observer is guarded
+    std::mutex observer_mutex;
+    std::function<void(const std::string&)> observer;
+
+    void NotifySynced(const std::string& path) {
+        std::lock_guard guard(observer_mutex);
+        if (observer) {
+            observer(path);
+        }
+    }
+
+}
+
+
+bool SyncFile(std::FILE* file, const std::string& path) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    const bool synced = _commit(_fileno(file)) == 0;
+#else
+    const bool synced = fsync(fileno(file)) == 0;
+#endif
+    if (!synced) {
+        return false;
+    }
+    NotifySynced(path);
+    return true;
+}
+
+bool SyncDirectory(const std::string& path) {
+#ifndef _WIN32
+    const int directory = open(path.c_str(), O_RDONLY);
+    if (directory < 0) {
+        return false;
+    }
+    const bool synced = fsync(directory) == 0;
+    close(directory);
+    if (!synced) {
+        return false;
+    }
+#endif
+    NotifySynced(path);
+    return true;
+}
+
+void SetFileSyncObserver(std::function<void(const std::string&)> new_observer) {
+    std::lock_guard guard(observer_mutex);
+    observer = std::move(new_observer);
+}
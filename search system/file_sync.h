@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdio>
+#include <functional>
+#include <string>
+
+
+// Forces written data to the disk, so it survives a crash of the machine and not only of the process.
+// Snapshots and the write-ahead log make their files durable through these functions.
+
+// Syncs the contents of an open file, path only names it for the observer. False if the sync fails.
+bool SyncFile(std::FILE* file, const std::string& path);
+
+// Syncs the entries of a directory, such as the name of a file just renamed into it. False if the
+// sync fails. Windows offers no such sync, so there it only reports success.
+bool SyncDirectory(const std::string& path);
+
+// Called with the path after every successful sync, so tests can check the order of syncs.
+// An empty function removes the observer.
+void SetFileSyncObserver(std::function<void(const std::string&)> observer);
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "forward_index.h"
+
+using namespace std::string_literals;
+
+
+ForwardIndex::ForwardIndex(MappedVector<uint32_t> term_ids, MappedVector<TermFreqCodec::Stored> term_freqs,
+    MappedVector<uint32_t> word_order, MappedVector<uint64_t> offsets)
+    : term_ids_(std::move(term_ids))
+    , term_freqs_(std::move(term_freqs))
+    , word_order_(std::move(word_order))
+    , offsets_(std::move(offsets)) {
+}
+
+void ForwardIndex::Add(const std::vector<uint32_t>& term_ids, const std::vector<double>& term_freqs,
+    const std::vector<std::string_view>& words) {
+    term_ids_.insert(term_ids_.end(), term_ids.begin(), term_ids.end());
+    for (double term_freq : term_freqs) {
+        term_freqs_.push_back(TermFreqCodec::Encode(term_freq));
+    }
+    const size_t first = word_order_.size();
+    for (size_t i = 0; i < term_ids.size(); ++i) {
+        word_order_.push_back(static_cast<uint32_t>(i));
+    }
+    std::sort(word_order_.begin() + first, word_order_.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return words[term_ids[lhs]] < words[term_ids[rhs]];
+        });
+    offsets_.push_back(term_ids_.size());
+}
+
+void ForwardIndex::Erase(const DocumentBitmap& documents) {
+    size_t kept = 0;
+    for (size_t ordinal = 0; ordinal + 1 < offsets_.size(); ++ordinal) {
+        const size_t begin = offsets_[ordinal];
+        const size_t end = offsets_[ordinal + 1];
+        offsets_[ordinal] = kept;
+        if (documents.Test(static_cast<int>(ordinal))) {
+            continue;
+        }
+        std::copy(term_ids_.begin() + begin, term_ids_.begin() + end, term_ids_.begin() + kept);
+        std::copy(term_freqs_.begin() + begin, term_freqs_.begin() + end, term_freqs_.begin() + kept);
+        // Positions count from the start of the document, so they move unchanged
+        std::copy(word_order_.begin() + begin, word_order_.begin() + end, word_order_.begin() + kept);
+        kept += end - begin;
+    }
+    offsets_.back() = kept;
+    term_ids_.resize(kept);
+    term_freqs_.resize(kept);
+    word_order_.resize(kept);
+}
+
+DocumentTerms ForwardIndex::Get(int ordinal) const {
+    if (ordinal < 0 || static_cast<size_t>(ordinal) + 1 >= offsets_.size()) {
+        return {};
+    }
+    const size_t offset = static_cast<size_t>(offsets_[ordinal]);
+    return { term_ids_.data() + offset, term_freqs_.data() + offset, word_order_.data() + offset,
+        static_cast<size_t>(offsets_[ordinal + 1] - offset) };
+}
+
+bool ForwardIndex::Contains(int ordinal, uint32_t term_id) const {
+    const DocumentTerms terms = Get(ordinal);
+    return std::binary_search(terms.term_ids, terms.term_ids + terms.size, term_id);
+}
+
+bool ForwardIndex::HasValidTerms(size_t term_count) const {
+    for (size_t ordinal = 0; ordinal + 1 < offsets_.size(); ++ordinal) {
+        const DocumentTerms terms = Get(static_cast<int>(ordinal));
+        for (size_t i = 0; i < terms.size; ++i) {
+            if (terms.term_ids[i] >= term_count || (i > 0 && terms.term_ids[i] <= terms.term_ids[i - 1])
+                || terms.word_order[i] >= terms.size) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+WordFrequencies::Iterator::Iterator(const WordFrequencies* frequencies, size_t index)
+    : frequencies_(frequencies), index_(index) {
+}
+
+WordFrequencies::Iterator::value_type WordFrequencies::Iterator::operator*() const {
+    const DocumentTerms& terms = frequencies_->document_terms_;
+    return { frequencies_->GetWord(index_), TermFreqCodec::Decode(terms.term_freqs[terms.word_order[index_]]) };
+}
+
+WordFrequencies::Iterator& WordFrequencies::Iterator::operator++() {
+    ++index_;
+    return *this;
+}
+
+bool WordFrequencies::Iterator::operator==(const Iterator& other) const {
+    return index_ == other.index_;
+}
+
+bool WordFrequencies::Iterator::operator!=(const Iterator& other) const {
+    return !(*this == other);
+}
+
+WordFrequencies::WordFrequencies(const std::vector<std::string_view>& terms, DocumentTerms document_terms)
+    : terms_(&terms), document_terms_(document_terms) {
+}
+
+WordFrequencies::Iterator WordFrequencies::begin() const {
+    return Iterator(this, 0);
+}
+
+WordFrequencies::Iterator WordFrequencies::end() const {
+    return Iterator(this, document_terms_.size);
+}
+
+size_t WordFrequencies::size() const {
+    return document_terms_.size;
+}
+
+bool WordFrequencies::empty() const {
+    return document_terms_.size == 0;
+}
+
+double WordFrequencies::at(std::string_view word) const {
+    size_t first = 0;
+    size_t last = document_terms_.size;
+    while (first < last) {
+        const size_t middle = first + (last - first) / 2;
+        if (GetWord(middle) < word) {
+            first = middle + 1;
+        }
+        else {
+            last = middle;
+        }
+    }
+    if (first == document_terms_.size || GetWord(first) != word) {
+        throw std::out_of_range("Document has no such word"s);
+    }
+    return TermFreqCodec::Decode(document_terms_.term_freqs[document_terms_.word_order[first]]);
+}
+
+const uint32_t* WordFrequencies::GetTermIds() const {
+    return document_terms_.term_ids;
+}
+
+std::string_view WordFrequencies::GetWord(size_t position) const {
+    return (*terms_)[document_terms_.term_ids[document_terms_.word_order[position]]];
+}
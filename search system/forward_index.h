@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "term_freq.h"
+#include "document_bitmap.h"
+#include "mapped_vector.h"
+
+
+// Terms of one document: ascending term ids with their TF, and the positions of the terms in
+// alphabetical order of their words
+struct DocumentTerms {
+    const uint32_t* term_ids = nullptr;
+    const TermFreqCodec::Stored* term_freqs = nullptr;
+    const uint32_t* word_order = nullptr;
+    size_t size = 0;
+};
+
+// Terms of every document stored back to back in flat arrays and addressed by document ordinal
+class ForwardIndex {
+public:
+    ForwardIndex() = default;
+    // Index over arrays laid out like its own, such as arrays viewing a mapped snapshot. The offsets
+    // start at 0, do not decrease and end at the size of the other arrays, which have equal sizes.
+    ForwardIndex(MappedVector<uint32_t> term_ids, MappedVector<TermFreqCodec::Stored> term_freqs,
+        MappedVector<uint32_t> word_order, MappedVector<uint64_t> offsets);
+
+    // Appends the terms of the next ordinal, term_ids must be ascending and unique. words holds the
+    // word of every term id and orders the terms alphabetically once here, so reads never sort.
+    void Add(const std::vector<uint32_t>& term_ids, const std::vector<double>& term_freqs,
+        const std::vector<std::string_view>& words);
+
+    // Drops the terms of every ordinal set in documents, their ranges become empty
+    void Erase(const DocumentBitmap& documents);
+
+    // Nothing for ordinals that were never added
+    DocumentTerms Get(int ordinal) const;
+
+    bool Contains(int ordinal, uint32_t term_id) const;
+
+    // True if the term ids of every document ascend and are below term_count and its alphabetical
+    // positions lie in the document, as they must be in arrays read from a file before Get hands them out
+    bool HasValidTerms(size_t term_count) const;
+
+private:
+    MappedVector<uint32_t> term_ids_;
+    MappedVector<TermFreqCodec::Stored> term_freqs_;
+    // Positions counted from the first term of the document
+    MappedVector<uint32_t> word_order_;
+    // Terms of ordinal i are [offsets_[i], offsets_[i + 1])
+    MappedVector<uint64_t> offsets_ = { 0 };
+};
+
+// Read-only view of the words of a document and their TF in alphabetical order, valid until the
+// server changes. Reading it neither allocates nor sorts, the order is kept by the forward index.
+class WordFrequencies {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator(const WordFrequencies* frequencies, size_t index);
+
+        value_type operator*() const;
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const;
+
+    private:
+        const WordFrequencies* frequencies_;
+        size_t index_;
+    };
+
+    WordFrequencies() = default;
+    WordFrequencies(const std::vector<std::string_view>& terms, DocumentTerms document_terms);
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    // Binary search over the alphabetical order. Throws std::out_of_range if the document has no such word
+    double at(std::string_view word) const;
+
+    // Ascending ids of the words, equal documents have equal sequences
+    const uint32_t* GetTermIds() const;
+
+private:
+    const std::vector<std::string_view>* terms_ = nullptr;
+    DocumentTerms document_terms_;
+
+    // Word of the term at the alphabetical position
+    std::string_view GetWord(size_t position) const;
+};
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "index_segment.h"
+
+using namespace std::string_literals;
+
+
+IndexSegment::IndexSegment(int first_ordinal)
+    : first_ordinal_(first_ordinal) {
+}
+
+IndexSegment IndexSegment::FromLists(int first_ordinal, int end_ordinal, std::vector<uint32_t> term_ids, std::vector<Postings> postings) {
+    IndexSegment segment(first_ordinal);
+    segment.term_ids_ = std::move(term_ids);
+    segment.postings_ = std::move(postings);
+    segment.end_ordinal_ = end_ordinal;
+    segment.frozen_ = true;
+    return segment;
+}
+
+void IndexSegment::ResizeTerms(size_t term_count) {
+    if (frozen_) {
+        throw std::logic_error("Segment is frozen"s);
+    }
+    if (postings_.size() < term_count) {
+        postings_.resize(term_count);
+    }
+}
+
+void IndexSegment::Add(uint32_t term_id, int ordinal, double term_freq) {
+    postings_[term_id].Add(ordinal, term_freq);
+}
+
+const IndexSegment::Postings* IndexSegment::Find(uint32_t term_id) const {
+    if (!frozen_) {
+        return term_id < postings_.size() && !postings_[term_id].empty() ? &postings_[term_id] : nullptr;
+    }
+    const auto it = std::lower_bound(term_ids_.begin(), term_ids_.end(), term_id);
+    if (it == term_ids_.end() || *it != term_id) {
+        return nullptr;
+    }
+    return &postings_[it - term_ids_.begin()];
+}
+
+IndexSegment::Postings* IndexSegment::Find(uint32_t term_id) {
+    return const_cast<Postings*>(static_cast<const IndexSegment&>(*this).Find(term_id));
+}
+
+void IndexSegment::Freeze(int end_ordinal) {
+    if (frozen_) {
+        return;
+    }
+    size_t kept = 0;
+    for (size_t term_id = 0; term_id < postings_.size(); ++term_id) {
+        if (postings_[term_id].empty()) {
+            continue;
+        }
+        term_ids_.push_back(static_cast<uint32_t>(term_id));
+        if (kept != term_id) {
+            postings_[kept] = std::move(postings_[term_id]);
+        }
+        ++kept;
+    }
+    postings_.resize(kept);
+    postings_.shrink_to_fit();
+    end_ordinal_ = end_ordinal;
+    frozen_ = true;
+}
+
+bool IndexSegment::IsFrozen() const {
+    return frozen_;
+}
+
+int IndexSegment::GetFirstOrdinal() const {
+    return first_ordinal_;
+}
+
+int IndexSegment::GetEndOrdinal() const {
+    return end_ordinal_;
+}
+
+size_t IndexSegment::GetDocumentCount() const {
+    return frozen_ ? static_cast<size_t>(end_ordinal_ - first_ordinal_) : 0;
+}
+
+IndexSegment IndexSegment::Merge(const std::vector<const IndexSegment*>& segments, const DocumentBitmap& removed) {
+    IndexSegment merged(segments.front()->first_ordinal_);
+    std::vector<uint32_t> term_ids;
+    for (const IndexSegment* segment : segments) {
+        term_ids.insert(term_ids.end(), segment->term_ids_.begin(), segment->term_ids_.end());
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+
+    merged.term_ids_.reserve(term_ids.size());
+    merged.postings_.reserve(term_ids.size());
+    for (uint32_t term_id : term_ids) {
+        Postings postings;
+        // Segments come in ordinal order, so every posting is an append
+        for (const IndexSegment* segment : segments) {
+            if (const Postings* source = segment->Find(term_id)) {
+                source->ForEach([&postings, &removed](int ordinal, double term_freq) {
+                    if (!removed.Test(ordinal)) {
+                        postings.Add(ordinal, term_freq);
+                    }
+                    });
+            }
+        }
+        if (!postings.empty()) {
+            merged.term_ids_.push_back(term_id);
+            merged.postings_.push_back(std::move(postings));
+        }
+    }
+    merged.end_ordinal_ = segments.back()->end_ordinal_;
+    merged.frozen_ = true;
+    return merged;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "posting_list.h"
+#include "compressed_posting_list.h"
+#include "document_bitmap.h"
+
+
+// Postings of the documents with ordinals in [GetFirstOrdinal(), GetEndOrdinal()), by term id.
+// Documents are only added to a mutable segment. Freezing keeps the non-empty lists only and
+// the segment is never changed afterwards, so other threads may read it without locks.
+class IndexSegment {
+public:
+    // Define SEARCH_SERVER_COMPRESSED_POSTINGS to keep posting document ids bit-packed
+#ifdef SEARCH_SERVER_COMPRESSED_POSTINGS
+    using Postings = CompressedPostingList;
+#else
+    using Postings = PostingList;
+#endif
+
+    explicit IndexSegment(int first_ordinal = 0);
+
+    // Frozen segment of documents [first_ordinal, end_ordinal) made of lists built elsewhere, such as
+    // lists viewing a mapped snapshot. The term ids are ascending and every list is not empty.
+    static IndexSegment FromLists(int first_ordinal, int end_ordinal, std::vector<uint32_t> term_ids, std::vector<Postings> postings);
+
+    // Makes room for term ids below term_count, the segment must be mutable
+    void ResizeTerms(size_t term_count);
+
+    // The term id must be below the ResizeTerms count, appends to different terms may run concurrently
+    void Add(uint32_t term_id, int ordinal, double term_freq);
+
+    // nullptr if no document of the segment has the term
+    const Postings* Find(uint32_t term_id) const;
+    Postings* Find(uint32_t term_id);
+
+    // Drops the empty lists, documents up to end_ordinal belong to the segment
+    void Freeze(int end_ordinal);
+    bool IsFrozen() const;
+
+    int GetFirstOrdinal() const;
+    // Only known once the segment is frozen
+    int GetEndOrdinal() const;
+    size_t GetDocumentCount() const;
+
+    // Frozen segment holding the adjacent frozen segments in ordinal order, without the postings
+    // of documents set in removed
+    static IndexSegment Merge(const std::vector<const IndexSegment*>& segments, const DocumentBitmap& removed);
+
+private:
+    int first_ordinal_;
+    int end_ordinal_ = -1;
+    bool frozen_ = false;
+    // Ascending ids of the lists once frozen, postings_ is indexed by term id before that
+    std::vector<uint32_t> term_ids_;
+    std::vector<Postings> postings_;
+};
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <execution>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "ingest_pipeline.h"
+#include "bounded_queue.h"
+
+using namespace std::string_literals;
+
+
+namespace {
+
+    // Whole lines read at once, the records of a batch point into it
+    using Chunk = std::shared_ptr<const std::string>;
+
+    struct Batch {
+        std::vector<DocumentInput> documents;
+        std::vector<Chunk> chunks;
+    };
+
+    int ParseNumber(std::string_view text) {
+        int value = 0;
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (text.empty() || error != std::errc() || end != text.data() + text.size()) {
+            throw std::invalid_argument("Invalid number in corpus record"s);
+        }
+        return value;
+    }
+
+    // Splits the input into chunks that end at a line end, the last one takes the rest
+    void ReadChunks(std::istream& input, size_t chunk_size, BoundedQueue<Chunk>& chunks) {
+        std::string carry;
+        while (true) {
+            auto chunk = std::make_shared<std::string>(std::move(carry));
+            carry = std::string();
+            const size_t begin = chunk->size();
+            chunk->resize(begin + chunk_size);
+            input.read(chunk->data() + begin, static_cast<std::streamsize>(chunk_size));
+            chunk->resize(begin + static_cast<size_t>(input.gcount()));
+            const bool at_end = !input;
+            if (!at_end) {
+                const size_t line_end = chunk->rfind('\n');
+                if (line_end == std::string::npos) {
+                    // A line longer than a chunk keeps growing until its end is read
+                    carry = std::move(*chunk);
+                    continue;
+                }
+                carry.assign(*chunk, line_end + 1);
+                chunk->resize(line_end + 1);
+            }
+            if (!chunk->empty() && !chunks.Push(std::move(chunk))) {
+                return;
+            }
+            if (at_end) {
+                return;
+            }
+        }
+    }
+
+    // Turns chunks into batches of batch_size records
+    void ParseChunks(size_t batch_size, BoundedQueue<Chunk>& chunks, BoundedQueue<Batch>& batches) {
+        Batch batch;
+        while (const auto chunk = chunks.Pop()) {
+            batch.chunks.push_back(*chunk);
+            std::string_view text = **chunk;
+            while (!text.empty()) {
+                const size_t line_end = std::min(text.find('\n'), text.size());
+                std::string_view line = text.substr(0, line_end);
+                text.remove_prefix(std::min(line_end + 1, text.size()));
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                if (line.empty()) {
+                    continue;
+                }
+                batch.documents.push_back(ParseDocumentRecord(line));
+                if (batch.documents.size() == batch_size) {
+                    // The chunk is still needed by the next batch if it has more lines
+                    const Chunk current = batch.chunks.back();
+                    if (!batches.Push(std::move(batch))) {
+                        return;
+                    }
+                    batch = Batch();
+                    batch.chunks.push_back(current);
+                }
+            }
+        }
+        if (!batch.documents.empty()) {
+            batches.Push(std::move(batch));
+        }
+    }
+
+}
+
+
+DocumentInput ParseDocumentRecord(std::string_view line) {
+    std::vector<std::string_view> fields;
+    for (size_t i = 0; i < 3; ++i) {
+        const size_t tab = line.find('\t');
+        if (tab == std::string_view::npos) {
+            break;
+        }
+        fields.push_back(line.substr(0, tab));
+        line.remove_prefix(tab + 1);
+    }
+    if (fields.size() != 1 && fields.size() != 3) {
+        throw std::invalid_argument("Corpus record must have 2 or 4 fields"s);
+    }
+
+    DocumentInput document;
+    document.id = ParseNumber(fields[0]);
+    document.text = line;
+    if (fields.size() == 3) {
+        const int status = ParseNumber(fields[1]);
+        if (status < 0 || status >= static_cast<int>(DOCUMENT_STATUS_COUNT)) {
+            throw std::invalid_argument("Invalid document status in corpus record"s);
+        }
+        document.status = static_cast<DocumentStatus>(status);
+        for (std::string_view rating : SplitIntoWords(fields[2])) {
+            document.ratings.push_back(ParseNumber(rating));
+        }
+    }
+    return document;
+}
+
+
+size_t IngestCorpus(std::istream& input, const std::function<void(const std::vector<DocumentInput>&)>& add_documents,
+    const IngestOptions& options) {
+    BoundedQueue<Chunk> chunks(options.queue_capacity);
+    BoundedQueue<Batch> batches(options.queue_capacity);
+    // Set instead of throwing, since exceptions must not leave a thread
+    std::exception_ptr reader_error;
+    std::exception_ptr parser_error;
+
+    std::thread reader([&] {
+        try {
+            ReadChunks(input, std::max<size_t>(options.chunk_size, 1), chunks);
+        }
+        catch (...) {
+            reader_error = std::current_exception();
+        }
+        chunks.Close();
+    });
+    std::thread parser([&] {
+        try {
+            ParseChunks(std::max<size_t>(options.batch_size, 1), chunks, batches);
+        }
+        catch (...) {
+            parser_error = std::current_exception();
+        }
+        // Stops the reader too if the parser gave up early
+        chunks.Close();
+        batches.Close();
+    });
+
+    size_t document_count = 0;
+    std::exception_ptr error;
+    try {
+        while (const auto batch = batches.Pop()) {
+            add_documents(batch->documents);
+            document_count += batch->documents.size();
+        }
+    }
+    catch (...) {
+        error = std::current_exception();
+        chunks.Close();
+        batches.Close();
+    }
+    reader.join();
+    parser.join();
+
+    for (const std::exception_ptr& stage_error : { error, parser_error, reader_error }) {
+        if (stage_error) {
+            std::rethrow_exception(stage_error);
+        }
+    }
+    return document_count;
+}
+
+size_t IngestCorpus(SearchServer& server, std::istream& input, const IngestOptions& options) {
+    return IngestCorpus(input, [&server](const std::vector<DocumentInput>& documents) {
+        server.AddDocuments(std::execution::par, documents);
+        }, options);
+}
+
+size_t IngestCorpusFile(SearchServer& server, const std::string& path, const IngestOptions& options) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Cannot open corpus "s + path);
+    }
+    return IngestCorpus(server, input, options);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+
+struct IngestOptions {
+    // Bytes taken from the input by one read
+    size_t chunk_size = size_t(4) << 20;
+    // Documents passed to one AddDocuments call
+    size_t batch_size = 16384;
+    // Chunks or batches that may wait between two stages before the earlier stage blocks
+    size_t queue_capacity = 4;
+};
+
+// Parses one corpus line, which is either "id<TAB>text" or "id<TAB>status<TAB>ratings<TAB>text".
+// Status is the number of a DocumentStatus and ratings are separated by spaces, a line of the short
+// form is ACTUAL without ratings. The text is a view into line. Throws std::invalid_argument.
+DocumentInput ParseDocumentRecord(std::string_view line);
+
+// Adds a corpus of one document per line in three overlapping stages, joined by bounded queues:
+// a reader thread takes large chunks of whole lines from the input, a parser thread splits them into
+// records that point into the chunks without copying the text, and the calling thread passes batches
+// to add_documents, which tokenizes them in parallel. Empty lines are skipped.
+// Returns the number of documents added. If a record or a batch is rejected, the stages stop and
+// the exception is rethrown; the batches before it stay added.
+size_t IngestCorpus(std::istream& input, const std::function<void(const std::vector<DocumentInput>&)>& add_documents,
+    const IngestOptions& options = {});
+// Batches go to server.AddDocuments(std::execution::par, batch)
+size_t IngestCorpus(SearchServer& server, std::istream& input, const IngestOptions& options = {});
+// Throws std::runtime_error if the file cannot be opened
+size_t IngestCorpusFile(SearchServer& server, const std::string& path, const IngestOptions& options = {});
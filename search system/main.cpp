@@ -1,5 +1,6 @@
 ﻿#include <iostream>
 #include <execution>
+#include <memory>
 #include <random>
 #include <string>
 #include <vector>
@@ -11,6 +12,7 @@
 #include "remove_duplicates.h"
 //#include "test_example_functions.h"
 #include "process_queries.h"
+#include "ranking_drift.h"
 
 using namespace std;
 
@@ -128,5 +130,27 @@ int main() {
 
         TEST(seq);
         TEST(par);
+        Test("wand"sv, search_server, queries, SearchMode::WAND);
+
+        cout << "TF precision drift: "s << MeasureRankingDrift(search_server, dictionary[0], documents, queries) << endl;
+    }
+    {
+        // Many short documents, so the per-document containers weigh on building and destroying the index
+        mt19937 generator;
+
+        const auto dictionary = GenerateDictionary(generator, 1000, 10);
+        const auto documents = GenerateQueries(generator, dictionary, 200'000, 5);
+
+        auto search_server = make_unique<SearchServer>(dictionary[0]);
+        {
+            LOG_DURATION("index build"s);
+            for (size_t i = 0; i < documents.size(); ++i) {
+                search_server->AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+            }
+        }
+        {
+            LOG_DURATION("index teardown"s);
+            search_server.reset();
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,324 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+
+// Array of trivially copyable elements that either owns them like std::vector or views elements
+// kept alive elsewhere, such as a section of a mapped snapshot. Reads never change the storage.
+// The first change of a view copies its elements to storage of its own, so the viewed memory is
+// only read. Copies of a view view the same memory. The object takes as much room as std::vector.
+template <typename T>
+class MappedVector {
+    static_assert(std::is_trivially_copyable_v<T>, "MappedVector keeps trivially copyable elements only");
+
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    MappedVector() = default;
+    MappedVector(std::initializer_list<T> values);
+    MappedVector(const MappedVector& other);
+    MappedVector(MappedVector&& other) noexcept;
+    MappedVector& operator=(const MappedVector& other);
+    MappedVector& operator=(MappedVector&& other) noexcept;
+    ~MappedVector();
+
+    // The elements must outlive the view and every copy of it
+    static MappedVector View(const T* data, size_t size);
+
+    bool IsView() const {
+        return capacity_ == 0 && data_ != nullptr;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    const T* data() const {
+        return data_;
+    }
+    const T& operator[](size_t index) const {
+        return data_[index];
+    }
+    const T* begin() const {
+        return data_;
+    }
+    const T* end() const {
+        return data_ + size_;
+    }
+    const T& front() const {
+        return data_[0];
+    }
+    const T& back() const {
+        return data_[size_ - 1];
+    }
+
+    // Non-const access is for changes, so it makes a view own its elements first
+    T* data();
+    T& operator[](size_t index);
+    T* begin();
+    T* end();
+    T& back();
+
+    void reserve(size_t capacity);
+    void resize(size_t size);
+    void resize(size_t size, const T& value);
+    void assign(size_t size, const T& value);
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last);
+    void clear();
+
+    void push_back(const T& value);
+    T* insert(const T* pos, const T& value);
+    // The inserted range must not lie in this array
+    template <typename InputIt>
+    T* insert(const T* pos, InputIt first, InputIt last);
+    T* erase(const T* pos);
+    T* erase(const T* first, const T* last);
+
+private:
+    // Views have no capacity, since their elements belong to someone else
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+
+    void MakeOwned();
+    // Moves the elements to a block of the given capacity, which is at least size_
+    void Reallocate(size_t capacity);
+    // Room for size elements, growing the capacity geometrically
+    void Grow(size_t size);
+    void Release();
+};
+
+template <typename T>
+MappedVector<T>::MappedVector(std::initializer_list<T> values) {
+    assign(values.begin(), values.end());
+}
+
+template <typename T>
+MappedVector<T>::MappedVector(const MappedVector& other) {
+    if (other.IsView()) {
+        data_ = other.data_;
+        size_ = other.size_;
+        return;
+    }
+    assign(other.begin(), other.end());
+}
+
+template <typename T>
+MappedVector<T>::MappedVector(MappedVector&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+    , capacity_(std::exchange(other.capacity_, 0)) {
+}
+
+template <typename T>
+MappedVector<T>& MappedVector<T>::operator=(const MappedVector& other) {
+    if (this != &other) {
+        MappedVector copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+template <typename T>
+MappedVector<T>& MappedVector<T>::operator=(MappedVector&& other) noexcept {
+    if (this != &other) {
+        Release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        capacity_ = std::exchange(other.capacity_, 0);
+    }
+    return *this;
+}
+
+template <typename T>
+MappedVector<T>::~MappedVector() {
+    Release();
+}
+
+template <typename T>
+MappedVector<T> MappedVector<T>::View(const T* data, size_t size) {
+    MappedVector view;
+    if (size > 0) {
+        view.data_ = const_cast<T*>(data);
+        view.size_ = size;
+    }
+    return view;
+}
+
+template <typename T>
+T* MappedVector<T>::data() {
+    MakeOwned();
+    return data_;
+}
+
+template <typename T>
+T& MappedVector<T>::operator[](size_t index) {
+    MakeOwned();
+    return data_[index];
+}
+
+template <typename T>
+T* MappedVector<T>::begin() {
+    MakeOwned();
+    return data_;
+}
+
+template <typename T>
+T* MappedVector<T>::end() {
+    MakeOwned();
+    return data_ + size_;
+}
+
+template <typename T>
+T& MappedVector<T>::back() {
+    MakeOwned();
+    return data_[size_ - 1];
+}
+
+template <typename T>
+void MappedVector<T>::reserve(size_t capacity) {
+    if (capacity > capacity_) {
+        Reallocate(capacity);
+    }
+}
+
+template <typename T>
+void MappedVector<T>::resize(size_t size) {
+    resize(size, T{});
+}
+
+template <typename T>
+void MappedVector<T>::resize(size_t size, const T& value) {
+    if (size > size_) {
+        Grow(size);
+        std::uninitialized_fill(data_ + size_, data_ + size, value);
+    }
+    else {
+        MakeOwned();
+    }
+    size_ = size;
+}
+
+template <typename T>
+void MappedVector<T>::assign(size_t size, const T& value) {
+    clear();
+    resize(size, value);
+}
+
+template <typename T>
+template <typename InputIt>
+void MappedVector<T>::assign(InputIt first, InputIt last) {
+    clear();
+    insert(data_, first, last);
+}
+
+template <typename T>
+void MappedVector<T>::clear() {
+    if (IsView()) {
+        data_ = nullptr;
+    }
+    size_ = 0;
+}
+
+template <typename T>
+void MappedVector<T>::push_back(const T& value) {
+    // The value may be an element of this array, so it is copied before the storage can move
+    const T copy = value;
+    Grow(size_ + 1);
+    data_[size_++] = copy;
+}
+
+template <typename T>
+T* MappedVector<T>::insert(const T* pos, const T& value) {
+    const T copy = value;
+    return insert(pos, &copy, &copy + 1);
+}
+
+template <typename T>
+template <typename InputIt>
+T* MappedVector<T>::insert(const T* pos, InputIt first, InputIt last) {
+    const size_t index = pos - data_;
+    const size_t count = static_cast<size_t>(std::distance(first, last));
+    if (size_ + count <= capacity_) {
+        std::copy_backward(data_ + index, data_ + size_, data_ + size_ + count);
+        std::copy(first, last, data_ + index);
+    }
+    else if (count > 0) {
+        // The values go straight to the new block between the elements around them
+        const size_t capacity = std::max(size_ + count, capacity_ * 2);
+        T* data = std::allocator<T>().allocate(capacity);
+        std::uninitialized_copy(data_, data_ + index, data);
+        std::uninitialized_copy(first, last, data + index);
+        std::uninitialized_copy(data_ + index, data_ + size_, data + index + count);
+        Release();
+        data_ = data;
+        capacity_ = capacity;
+    }
+    else {
+        MakeOwned();
+    }
+    size_ += count;
+    return data_ + index;
+}
+
+template <typename T>
+T* MappedVector<T>::erase(const T* pos) {
+    return erase(pos, pos + 1);
+}
+
+template <typename T>
+T* MappedVector<T>::erase(const T* first, const T* last) {
+    const size_t index = first - data_;
+    const size_t count = last - first;
+    MakeOwned();
+    std::copy(data_ + index + count, data_ + size_, data_ + index);
+    size_ -= count;
+    return data_ + index;
+}
+
+template <typename T>
+void MappedVector<T>::MakeOwned() {
+    if (IsView()) {
+        Reallocate(size_);
+    }
+}
+
+template <typename T>
+void MappedVector<T>::Reallocate(size_t capacity) {
+    std::allocator<T> allocator;
+    T* data = allocator.allocate(capacity);
+    std::uninitialized_copy(data_, data_ + size_, data);
+    Release();
+    data_ = data;
+    capacity_ = capacity;
+}
+
+template <typename T>
+void MappedVector<T>::Grow(size_t size) {
+    if (size > capacity_) {
+        Reallocate(std::max(size, capacity_ * 2));
+    }
+    else {
+        MakeOwned();
+    }
+}
+
+template <typename T>
+void MappedVector<T>::Release() {
+    if (capacity_ > 0) {
+        std::allocator<T>().deallocate(data_, capacity_);
+    }
+    data_ = nullptr;
+    capacity_ = 0;
+}
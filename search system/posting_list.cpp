@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "posting_list.h"
+
+using namespace std::string_literals;
+
+
+TermFreqMaxima::TermFreqMaxima(MappedVector<TermFreqCodec::Stored> maxima)
+    : maxima_(std::move(maxima)) {
+}
+
+size_t TermFreqMaxima::GetRangeCount(size_t size) {
+    return (size + RANGE_SIZE - 1) / RANGE_SIZE;
+}
+
+void TermFreqMaxima::Update(const MappedVector<TermFreqCodec::Stored>& term_freqs, size_t pos) {
+    const size_t range = pos / RANGE_SIZE;
+    if (range == maxima_.size()) {
+        maxima_.push_back(term_freqs[pos]);
+    }
+    else {
+        maxima_[range] = std::max(maxima_[range], term_freqs[pos]);
+    }
+}
+
+void TermFreqMaxima::Rebuild(const MappedVector<TermFreqCodec::Stored>& term_freqs, size_t pos) {
+    maxima_.resize(GetRangeCount(term_freqs.size()));
+    for (size_t range = pos / RANGE_SIZE; range < maxima_.size(); ++range) {
+        const auto begin = term_freqs.begin() + range * RANGE_SIZE;
+        const auto end = term_freqs.begin() + std::min(term_freqs.size(), (range + 1) * RANGE_SIZE);
+        maxima_[range] = *std::max_element(begin, end);
+    }
+}
+
+double TermFreqMaxima::Get(size_t range) const {
+    return TermFreqCodec::Decode(maxima_[range]);
+}
+
+double TermFreqMaxima::Get(size_t first_range, size_t last_range) const {
+    if (first_range == last_range) {
+        return 0.0;
+    }
+    return TermFreqCodec::Decode(*std::max_element(maxima_.begin() + first_range, maxima_.begin() + last_range));
+}
+
+const MappedVector<TermFreqCodec::Stored>& TermFreqMaxima::GetMaxima() const {
+    return maxima_;
+}
+
+
+void PostingList::AppendTo(Columns& columns) const {
+    columns.document_ids.insert(columns.document_ids.end(), document_ids_.begin(), document_ids_.end());
+    columns.term_freqs.insert(columns.term_freqs.end(), term_freqs_.begin(), term_freqs_.end());
+    const auto& maxima = max_term_freqs_.GetMaxima();
+    columns.max_term_freqs.insert(columns.max_term_freqs.end(), maxima.begin(), maxima.end());
+}
+
+PostingList PostingList::View(const Columns& columns, size_t size, ColumnPosition& position) {
+    const auto fits = [](const auto& column, size_t pos, size_t count) {
+        return pos <= column.size() && column.size() - pos >= count;
+    };
+    const size_t range_count = TermFreqMaxima::GetRangeCount(size);
+    if (!fits(columns.document_ids, position.postings, size) || !fits(columns.term_freqs, position.postings, size)
+        || !fits(columns.max_term_freqs, position.max_term_freqs, range_count)) {
+        throw std::out_of_range("Posting columns end before the list"s);
+    }
+    PostingList postings;
+    postings.document_ids_ = MappedVector<int>::View(columns.document_ids.data() + position.postings, size);
+    postings.term_freqs_ = MappedVector<TermFreqCodec::Stored>::View(columns.term_freqs.data() + position.postings, size);
+    postings.max_term_freqs_ = TermFreqMaxima(MappedVector<TermFreqCodec::Stored>::View(
+        columns.max_term_freqs.data() + position.max_term_freqs, range_count));
+    position.postings += size;
+    position.max_term_freqs += range_count;
+    return postings;
+}
+
+void PostingList::Add(int document_id, double term_freq) {
+    // Documents usually arrive in id order, so the common case is an append
+    if (document_ids_.empty() || document_ids_.back() < document_id) {
+        document_ids_.push_back(document_id);
+        term_freqs_.push_back(TermFreqCodec::Encode(term_freq));
+        max_term_freqs_.Update(term_freqs_, term_freqs_.size() - 1);
+        return;
+    }
+    const size_t pos = LowerBound(document_id);
+    if (pos < document_ids_.size() && document_ids_[pos] == document_id) {
+        term_freqs_[pos] = TermFreqCodec::Encode(TermFreqCodec::Decode(term_freqs_[pos]) + term_freq);
+        max_term_freqs_.Update(term_freqs_, pos);
+        return;
+    }
+    document_ids_.insert(document_ids_.begin() + pos, document_id);
+    term_freqs_.insert(term_freqs_.begin() + pos, TermFreqCodec::Encode(term_freq));
+    max_term_freqs_.Rebuild(term_freqs_, pos);
+}
+
+bool PostingList::Erase(int document_id) {
+    const size_t pos = LowerBound(document_id);
+    if (pos == document_ids_.size() || document_ids_[pos] != document_id) {
+        return false;
+    }
+    document_ids_.erase(document_ids_.begin() + pos);
+    term_freqs_.erase(term_freqs_.begin() + pos);
+    max_term_freqs_.Rebuild(term_freqs_, pos);
+    return true;
+}
+
+size_t PostingList::Erase(const DocumentBitmap& documents) {
+    size_t kept = 0;
+    size_t first_erased = document_ids_.size();
+    for (size_t pos = 0; pos < document_ids_.size(); ++pos) {
+        if (documents.Test(document_ids_[pos])) {
+            first_erased = std::min(first_erased, pos);
+            continue;
+        }
+        document_ids_[kept] = document_ids_[pos];
+        term_freqs_[kept] = term_freqs_[pos];
+        ++kept;
+    }
+    const size_t erased = document_ids_.size() - kept;
+    if (erased > 0) {
+        document_ids_.resize(kept);
+        term_freqs_.resize(kept);
+        max_term_freqs_.Rebuild(term_freqs_, first_erased);
+    }
+    return erased;
+}
+
+bool PostingList::Contains(int document_id) const {
+    return std::binary_search(document_ids_.begin(), document_ids_.end(), document_id);
+}
+
+double PostingList::GetTermFreq(int document_id) const {
+    const size_t pos = LowerBound(document_id);
+    if (pos == document_ids_.size() || document_ids_[pos] != document_id) {
+        return 0.0;
+    }
+    return TermFreqCodec::Decode(term_freqs_[pos]);
+}
+
+bool PostingList::HasValidDocumentIds(int end_document_id) const {
+    int previous_document_id = -1;
+    for (int document_id : document_ids_) {
+        if (document_id <= previous_document_id || document_id >= end_document_id) {
+            return false;
+        }
+        previous_document_id = document_id;
+    }
+    return true;
+}
+
+double PostingList::GetMaxTermFreq() const {
+    return max_term_freqs_.Get(0, TermFreqMaxima::GetRangeCount(term_freqs_.size()));
+}
+
+size_t PostingList::size() const {
+    return document_ids_.size();
+}
+
+bool PostingList::empty() const {
+    return document_ids_.empty();
+}
+
+size_t PostingList::LowerBound(int document_id) const {
+    return std::lower_bound(document_ids_.begin(), document_ids_.end(), document_id) - document_ids_.begin();
+}
+
+PostingList::Cursor::Cursor(const PostingList& postings)
+    : postings_(&postings) {
+}
+
+bool PostingList::Cursor::AtEnd() const {
+    return pos_ == postings_->document_ids_.size();
+}
+
+int PostingList::Cursor::GetDocumentId() const {
+    return postings_->document_ids_[pos_];
+}
+
+double PostingList::Cursor::GetTermFreq() const {
+    return TermFreqCodec::Decode(postings_->term_freqs_[pos_]);
+}
+
+void PostingList::Cursor::Next() {
+    ++pos_;
+}
+
+void PostingList::Cursor::Advance(int document_id) {
+    pos_ = Seek(document_id);
+}
+
+PostingBlockBound PostingList::Cursor::GetBlockBound(int document_id) const {
+    const auto& ids = postings_->document_ids_;
+    const size_t pos = Seek(document_id);
+    if (pos == ids.size()) {
+        return {};
+    }
+    const size_t range = pos / TermFreqMaxima::RANGE_SIZE;
+    const size_t range_end = std::min(ids.size(), (range + 1) * TermFreqMaxima::RANGE_SIZE);
+    return { ids[range_end - 1], postings_->max_term_freqs_.Get(range) };
+}
+
+size_t PostingList::Cursor::Seek(int document_id) const {
+    // Targets are usually close, so the range is found by doubling steps before the binary search
+    const auto& ids = postings_->document_ids_;
+    size_t begin = pos_;
+    size_t step = 1;
+    while (begin + step < ids.size() && ids[begin + step] < document_id) {
+        begin += step;
+        step *= 2;
+    }
+    const size_t end = std::min(ids.size(), begin + step + 1);
+    return std::lower_bound(ids.begin() + begin, ids.begin() + end, document_id) - ids.begin();
+}
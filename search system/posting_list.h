@@ -0,0 +1,158 @@
+#pragma once
+#include <climits>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "term_freq.h"
+#include "mapped_vector.h"
+#include "document_bitmap.h"
+
+
+// Upper bound of the term frequency over a block of postings
+struct PostingBlockBound {
+    // INT_MAX if there are no postings left
+    int last_document_id = INT_MAX;
+    double max_term_freq = 0.0;
+};
+
+// The largest term frequency of every RANGE_SIZE consecutive postings, kept next to the term
+// frequencies of a posting list to bound scores for dynamic pruning
+class TermFreqMaxima {
+public:
+    static const size_t RANGE_SIZE = 16;
+
+    TermFreqMaxima() = default;
+    // Maxima saved by GetMaxima, possibly viewed where they lie
+    explicit TermFreqMaxima(MappedVector<TermFreqCodec::Stored> maxima);
+
+    // Ranges of a list of size postings
+    static size_t GetRangeCount(size_t size);
+
+    // Call after term_freqs[pos] changed in place or was appended
+    void Update(const MappedVector<TermFreqCodec::Stored>& term_freqs, size_t pos);
+
+    // Call after postings from pos on were shifted by an insertion or an erasure
+    void Rebuild(const MappedVector<TermFreqCodec::Stored>& term_freqs, size_t pos);
+
+    double Get(size_t range) const;
+    // Bound of the ranges [first_range, last_range)
+    double Get(size_t first_range, size_t last_range) const;
+
+    const MappedVector<TermFreqCodec::Stored>& GetMaxima() const;
+
+private:
+    MappedVector<TermFreqCodec::Stored> maxima_;
+};
+
+// Postings of a single term: document ids in ascending order with their TF in a parallel array
+class PostingList {
+public:
+    // Document-at-a-time iteration over the postings
+    class Cursor {
+    public:
+        explicit Cursor(const PostingList& postings);
+
+        bool AtEnd() const;
+        int GetDocumentId() const;
+        double GetTermFreq() const;
+        void Next();
+
+        // Moves to the first posting with id >= document_id
+        void Advance(int document_id);
+
+        // Bound of the range holding the first posting with id >= document_id, the cursor does not move
+        PostingBlockBound GetBlockBound(int document_id) const;
+
+    private:
+        const PostingList* postings_;
+        size_t pos_ = 0;
+
+        // Position of the first posting with id >= document_id, not before the cursor
+        size_t Seek(int document_id) const;
+    };
+
+    // Arrays of many lists stored back to back, the way a snapshot keeps them
+    struct Columns {
+        MappedVector<int> document_ids;
+        MappedVector<TermFreqCodec::Stored> term_freqs;
+        MappedVector<TermFreqCodec::Stored> max_term_freqs;
+
+        // Calls function(column) for every column, always in the same order
+        template <typename Function>
+        void ForEach(Function function);
+        template <typename Function>
+        void ForEach(Function function) const;
+    };
+
+    // Where the next list starts in every column
+    struct ColumnPosition {
+        size_t postings = 0;
+        size_t max_term_freqs = 0;
+    };
+
+    // Appends the arrays of the list to columns
+    void AppendTo(Columns& columns) const;
+
+    // List of size postings stored at position, which moves past it. The list views the memory of
+    // the columns, which must outlive it, and copies it only once it is changed.
+    // Throws std::out_of_range if the columns end before the list.
+    static PostingList View(const Columns& columns, size_t size, ColumnPosition& position);
+
+    // Adds term frequency of the document, keeping document ids sorted
+    void Add(int document_id, double term_freq);
+
+    // Returns false if the document is not in the list
+    bool Erase(int document_id);
+
+    // Removes the postings of every document set in documents in one pass, returns how many were removed
+    size_t Erase(const DocumentBitmap& documents);
+
+    bool Contains(int document_id) const;
+
+    // True if the document ids ascend and lie in [0, end_document_id), as they must in a list
+    // viewing columns read from a file before it is searched
+    bool HasValidDocumentIds(int end_document_id) const;
+
+    // Term frequency of the document or 0.0 if it is not in the list
+    double GetTermFreq(int document_id) const;
+
+    // The largest term frequency in the list
+    double GetMaxTermFreq() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    // Calls function(document_id, term_freq) for each posting in document id order
+    template <typename Function>
+    void ForEach(Function function) const;
+
+private:
+    MappedVector<int> document_ids_;
+    MappedVector<TermFreqCodec::Stored> term_freqs_;
+    TermFreqMaxima max_term_freqs_;
+
+    size_t LowerBound(int document_id) const;
+};
+
+template <typename Function>
+void PostingList::Columns::ForEach(Function function) {
+    function(document_ids);
+    function(term_freqs);
+    function(max_term_freqs);
+}
+
+template <typename Function>
+void PostingList::Columns::ForEach(Function function) const {
+    function(document_ids);
+    function(term_freqs);
+    function(max_term_freqs);
+}
+
+template <typename Function>
+void PostingList::ForEach(Function function) const {
+    const size_t count = document_ids_.size();
+    for (size_t i = 0; i < count; ++i) {
+        function(document_ids_[i], TermFreqCodec::Decode(term_freqs_[i]));
+    }
+}
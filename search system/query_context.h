@@ -0,0 +1,29 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "document_bitmap.h"
+#include "score_accumulator.h"
+
+
+// Distinct plus and minus words of a query, views of the query text
+struct ParsedQuery {
+    std::vector<std::string_view> minus_words;
+    std::vector<std::string_view> plus_words;
+};
+
+// Buffers of a search kept from one query to the next. Once they have grown to the size of the
+// queries and of the index, a search run with the context takes no memory from the heap.
+// A context serves one search at a time, so each thread needs its own.
+class QueryContext {
+private:
+    friend class SearchServer;
+
+    std::vector<std::string_view> words_;
+    ParsedQuery query_;
+    DocumentBitmap candidates_;
+    ScoreAccumulator scores_;
+    // Found documents, returned by reference until the next search with the context
+    std::vector<Document> documents_;
+};
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+
+#include "ranking_drift.h"
+#include "string_processing.h"
+
+
+namespace {
+
+    // Exact TF-IDF over the raw documents, built the same way the server was before quantization
+    class ExactRanker {
+    public:
+        ExactRanker(std::string_view stop_words, const std::vector<std::string>& documents)
+            : document_count_(documents.size()) {
+            for (std::string_view word : SplitIntoWords(stop_words)) {
+                stop_words_.insert(word);
+            }
+            for (size_t id = 0; id < documents.size(); ++id) {
+                std::vector<std::string_view> words;
+                for (std::string_view word : SplitIntoWords(documents[id])) {
+                    if (stop_words_.count(word) == 0) {
+                        words.push_back(word);
+                    }
+                }
+                for (std::string_view word : words) {
+                    word_to_document_freqs_[word][static_cast<int>(id)] += 1.0 / words.size();
+                }
+            }
+        }
+
+        std::map<int, double> ComputeRelevance(std::string_view raw_query) const {
+            std::set<std::string_view> plus_words, minus_words;
+            for (std::string_view word : SplitIntoWords(raw_query)) {
+                const bool is_minus = word[0] == '-';
+                if (is_minus) {
+                    word.remove_prefix(1);
+                }
+                if (stop_words_.count(word) == 0) {
+                    (is_minus ? minus_words : plus_words).insert(word);
+                }
+            }
+
+            std::map<int, double> document_to_relevance;
+            for (std::string_view word : plus_words) {
+                const auto it = word_to_document_freqs_.find(word);
+                if (it == word_to_document_freqs_.end()) {
+                    continue;
+                }
+                const double inverse_document_freq = std::log(document_count_ * 1.0 / it->second.size());
+                for (const auto& [document_id, term_freq] : it->second) {
+                    document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                }
+            }
+            for (std::string_view word : minus_words) {
+                const auto it = word_to_document_freqs_.find(word);
+                if (it == word_to_document_freqs_.end()) {
+                    continue;
+                }
+                for (const auto& [document_id, _] : it->second) {
+                    document_to_relevance.erase(document_id);
+                }
+            }
+            return document_to_relevance;
+        }
+
+    private:
+        size_t document_count_;
+        std::set<std::string_view> stop_words_;
+        std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
+    };
+
+}
+
+
+RankingDrift MeasureRankingDrift(const SearchServer& server, std::string_view stop_words,
+    const std::vector<std::string>& documents, const std::vector<std::string>& queries) {
+    const ExactRanker ranker(stop_words, documents);
+    RankingDrift drift;
+    double overlap_sum = 0.0;
+
+    for (const std::string& query : queries) {
+        const std::map<int, double> exact = ranker.ComputeRelevance(query);
+        std::vector<double> exact_relevances;
+        for (const auto& [document_id, relevance] : exact) {
+            exact_relevances.push_back(relevance);
+        }
+        const size_t expected_count = std::min<size_t>(exact_relevances.size(), MAX_RESULT_DOCUMENT_COUNT);
+        std::sort(exact_relevances.begin(), exact_relevances.end(), std::greater<>());
+        const double threshold = expected_count == 0 ? 0.0 : exact_relevances[expected_count - 1] - EPSILON;
+
+        // Documents tied with the last exact one are an equally good answer
+        size_t overlap = 0;
+        for (const Document& document : server.FindTopDocuments(query)) {
+            const auto it = exact.find(document.id);
+            if (it == exact.end()) {
+                continue;
+            }
+            drift.max_relevance_error = std::max(drift.max_relevance_error, std::abs(it->second - document.relevance));
+            if (it->second >= threshold) {
+                ++overlap;
+            }
+        }
+
+        ++drift.query_count;
+        if (overlap < expected_count) {
+            ++drift.changed_queries;
+        }
+        overlap_sum += expected_count == 0 ? 1.0 : overlap * 1.0 / expected_count;
+    }
+
+    if (drift.query_count > 0) {
+        drift.mean_overlap = overlap_sum / drift.query_count;
+    }
+    return drift;
+}
+
+std::ostream& operator<<(std::ostream& output, const RankingDrift& drift) {
+    output << "{ queries = "s << drift.query_count
+        << ", changed = "s << drift.changed_queries
+        << ", mean_overlap = "s << drift.mean_overlap
+        << ", max_relevance_error = "s << drift.max_relevance_error
+        << " }"s;
+    return output;
+}
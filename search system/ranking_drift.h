@@ -0,0 +1,26 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+
+// Difference between the rankings of a server and exact double precision TF-IDF
+struct RankingDrift {
+    size_t query_count = 0;
+    // Queries whose top documents differ from the exact ones as a set
+    size_t changed_queries = 0;
+    // Average share of the exact top documents that the server also returned
+    double mean_overlap = 1.0;
+    double max_relevance_error = 0.0;
+};
+
+// Ranks every query against the raw documents with exact TF-IDF and compares the result with
+// server.FindTopDocuments(query). documents[i] must have been added to the server as id i with
+// status ACTUAL and equal ratings, so that only relevance decides the order.
+RankingDrift MeasureRankingDrift(const SearchServer& server, std::string_view stop_words,
+    const std::vector<std::string>& documents, const std::vector<std::string>& queries);
+
+std::ostream& operator<<(std::ostream& output, const RankingDrift& drift);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <set>
 #include <string>
 #include <vector>
@@ -6,14 +7,15 @@
 
 
 void RemoveDuplicates(SearchServer& search_server) {
-    std::set<std::set<std::string_view>> docs;
+    // Words are interned, so documents with the same words have the same sorted term ids. The views
+    // stay valid because nothing is removed before the scan ends.
+    const auto less = [](const DocumentTerms& lhs, const DocumentTerms& rhs) {
+        return std::lexicographical_compare(lhs.term_ids, lhs.term_ids + lhs.size, rhs.term_ids, rhs.term_ids + rhs.size);
+    };
+    std::set<DocumentTerms, decltype(less)> docs(less);
     std::vector<int> ids_to_remove;
     for (int document_id : search_server) {
-        std::set<std::string_view> keys;
-        for (auto& [word, freq] : search_server.GetWordFrequencies(document_id)) {
-            keys.emplace(word);
-        }
-        if (!docs.emplace(keys).second) {
+        if (!docs.insert(search_server.GetDocumentTerms(document_id)).second) {
             ids_to_remove.push_back(document_id);
         }
     }
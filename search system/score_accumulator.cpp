@@ -0,0 +1,33 @@
+#include <algorithm>
+
+#include "score_accumulator.h"
+
+
+void ScoreAccumulator::Reset(size_t ordinal_count) {
+    touched_.clear();
+    ordinal_count_ = ordinal_count;
+    if (generations_.size() < ordinal_count) {
+        generations_.resize(ordinal_count, STALE);
+        scores_.resize(ordinal_count);
+    }
+    ++generation_;
+    // After a wrap around stale stamps could match again
+    if (generation_ == STALE) {
+        std::fill(generations_.begin(), generations_.end(), STALE);
+        generation_ = STALE + 1;
+    }
+}
+
+void ScoreAccumulator::SortTouched() {
+    // A query touching a good share of the documents is cheaper to collect by a linear scan
+    if (touched_.size() * 16 < ordinal_count_) {
+        std::sort(touched_.begin(), touched_.end());
+        return;
+    }
+    touched_.clear();
+    for (size_t ordinal = 0; ordinal < ordinal_count_; ++ordinal) {
+        if (generations_[ordinal] == generation_) {
+            touched_.push_back(static_cast<int>(ordinal));
+        }
+    }
+}
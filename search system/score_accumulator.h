@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Relevance sums of one query in a dense array indexed by document ordinal. Only ordinals
+// touched by the query are listed, and Reset forgets them all by bumping a generation
+// counter, so one accumulator is reused from query to query without clearing the array.
+class ScoreAccumulator {
+public:
+    // Starts a new query over ordinals [0, ordinal_count)
+    void Reset(size_t ordinal_count);
+
+    void Add(int ordinal, double score) {
+        if (generations_[ordinal] != generation_) {
+            generations_[ordinal] = generation_;
+            scores_[ordinal] = score;
+            touched_.push_back(ordinal);
+        }
+        else {
+            scores_[ordinal] += score;
+        }
+    }
+
+    bool Contains(int ordinal) const {
+        return generations_[ordinal] == generation_;
+    }
+
+    double Get(int ordinal) const {
+        return scores_[ordinal];
+    }
+
+    // Ordinals in order of their first Add
+    const std::vector<int>& GetTouched() const {
+        return touched_;
+    }
+
+    // Sorts GetTouched() by ordinal
+    void SortTouched();
+
+private:
+    static constexpr uint32_t STALE = 0;
+
+    std::vector<double> scores_;
+    std::vector<uint32_t> generations_;
+    std::vector<int> touched_;
+    size_t ordinal_count_ = 0;
+    uint32_t generation_ = STALE;
+};
@@ -1,4 +1,5 @@
 #include "search_server.h"
+#include "snapshot_file.h"
 
 
 SearchServer::SearchServer(const std::string& stop_words_text)
@@ -24,28 +25,288 @@ SearchServer::SearchServer(std::string_view stop_words_text)
 
 
 void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    CheckNewDocumentId(document_id);
+
+    std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(document, words);
+    std::vector<uint32_t> term_ids;
+    term_ids.reserve(words.size());
+    for (std::string_view word : words) {
+        term_ids.push_back(InternTerm(word));
+    }
+    std::vector<double> term_freqs;
+    CountTerms(term_ids, term_freqs);
+    const int ordinal = static_cast<int>(ordinal_to_id_.size());
+    for (size_t i = 0; i < term_ids.size(); ++i) {
+        mutable_segment_.Add(term_ids[i], ordinal, term_freqs[i]);
+        ++document_freqs_[term_ids[i]];
+        UpdateDocumentFreq(term_ids[i]);
+    }
+    AppendDocument(document_id, status, ComputeAverageRating(ratings), term_ids, term_freqs);
+    UpdateSegments();
+}
+
+
+void SearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+
+void SearchServer::CheckNewDocumentId(int document_id) const {
     if (document_id < 0) {
         throw std::invalid_argument("Negative ID"s);
     }
-    if (documents_.count(document_id) > 0) {
+    if (document_ids_.Contains(document_id)) {
         throw std::invalid_argument("ID out of range");
     }
+}
 
-    const auto& words = SplitIntoWordsNoStop(document);
-    const double inv_word_count = 1.0 / words.size();
-    for (const auto& word : words) {
-        word_to_id_freqs_[std::string(word)][document_id] += inv_word_count;
-        id_to_word_freqs_[document_id][std::string(word)] += inv_word_count;
+
+void SearchServer::CheckNewDocumentIds(const std::vector<DocumentInput>& documents) const {
+    // The nodes are only needed for the check and are released at once
+    std::pmr::monotonic_buffer_resource batch_memory;
+    std::pmr::set<int> batch_ids(&batch_memory);
+    for (const DocumentInput& document : documents) {
+        CheckNewDocumentId(document.id);
+        if (!batch_ids.insert(document.id).second) {
+            throw std::invalid_argument("ID out of range"s);
+        }
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
-    document_ids_.insert(document_id);
 }
 
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-        });
+void SearchServer::CheckDocument(int document_id, std::string_view document) const {
+    CheckNewDocumentId(document_id);
+    if (!IsValidWord(document)) {
+        throw std::invalid_argument("Text contain invalid symbols"s);
+    }
+}
+
+
+void SearchServer::CheckDocuments(const std::vector<DocumentInput>& documents) const {
+    CheckNewDocumentIds(documents);
+    for (const DocumentInput& document : documents) {
+        if (!IsValidWord(document.text)) {
+            throw std::invalid_argument("Text contain invalid symbols"s);
+        }
+    }
+}
+
+
+void SearchServer::CountTerms(std::vector<uint32_t>& term_ids, std::vector<double>& term_freqs) {
+    const double inv_word_count = 1.0 / term_ids.size();
+    std::sort(term_ids.begin(), term_ids.end());
+    term_freqs.clear();
+    size_t unique_count = 0;
+    for (size_t i = 0; i < term_ids.size();) {
+        size_t j = i + 1;
+        while (j < term_ids.size() && term_ids[j] == term_ids[i]) {
+            ++j;
+        }
+        term_ids[unique_count++] = term_ids[i];
+        term_freqs.push_back((j - i) * inv_word_count);
+        i = j;
+    }
+    term_ids.resize(unique_count);
+}
+
+
+void SearchServer::AppendDocument(int document_id, DocumentStatus status, int rating,
+    const std::vector<uint32_t>& term_ids, const std::vector<double>& term_freqs) {
+    const int ordinal = static_cast<int>(ordinal_to_id_.size());
+    forward_index_.Add(term_ids, term_freqs, terms_.GetWords());
+    document_ids_.Add(document_id, ordinal);
+    ordinal_to_id_.push_back(document_id);
+    statuses_.push_back(status);
+    for (DocumentBitmap& documents : status_documents_) {
+        documents.Resize(ordinal + 1);
+    }
+    status_documents_[static_cast<size_t>(status)].Set(ordinal);
+    live_documents_.Resize(ordinal + 1);
+    live_documents_.Set(ordinal);
+    ratings_.push_back(rating);
+    log_document_count_ = std::log(GetDocumentCount());
+}
+
+
+void SearchServer::BuildPartialIndex(const std::vector<DocumentInput>& documents, PartialIndex& partial) const {
+    try {
+        std::unordered_map<std::string_view, uint32_t> local_ids;
+        // Occurrences in the current document by local term id, zeroed again after each document
+        std::vector<uint32_t> occurrences;
+        std::vector<std::string_view> words;
+        partial.offsets.push_back(0);
+        for (size_t i = 0; i < partial.document_count; ++i) {
+            SplitIntoWordsNoStop(documents[partial.first_document + i].text, words);
+            const size_t document_begin = partial.term_ids.size();
+            for (std::string_view word : words) {
+                const auto [it, inserted] = local_ids.emplace(word, static_cast<uint32_t>(partial.terms.size()));
+                if (inserted) {
+                    partial.terms.push_back(word);
+                    occurrences.push_back(0);
+                }
+                if (occurrences[it->second]++ == 0) {
+                    partial.term_ids.push_back(it->second);
+                }
+            }
+            const double inv_word_count = 1.0 / words.size();
+            for (size_t pos = document_begin; pos < partial.term_ids.size(); ++pos) {
+                uint32_t& count = occurrences[partial.term_ids[pos]];
+                partial.term_freqs.push_back(count * inv_word_count);
+                count = 0;
+            }
+            partial.offsets.push_back(partial.term_ids.size());
+        }
+    }
+    catch (...) {
+        partial.error = std::current_exception();
+    }
+}
+
+
+void SearchServer::InternPartialTerms(std::vector<PartialIndex>& partials) {
+    for (const PartialIndex& partial : partials) {
+        if (partial.error) {
+            std::rethrow_exception(partial.error);
+        }
+    }
+    // One dictionary lookup per distinct word of a slice instead of one per token
+    for (PartialIndex& partial : partials) {
+        partial.global_ids.reserve(partial.terms.size());
+        for (std::string_view word : partial.terms) {
+            partial.global_ids.push_back(InternTerm(word));
+        }
+    }
+}
+
+
+void SearchServer::SortPartialIndex(PartialIndex& partial, int first_ordinal, size_t shard_count) {
+    partial.shards.resize(shard_count);
+    std::vector<std::pair<uint32_t, double>> terms;
+    for (size_t i = 0; i < partial.document_count; ++i) {
+        const size_t begin = partial.offsets[i];
+        const size_t end = partial.offsets[i + 1];
+        terms.clear();
+        for (size_t pos = begin; pos < end; ++pos) {
+            terms.emplace_back(partial.global_ids[partial.term_ids[pos]], partial.term_freqs[pos]);
+        }
+        std::sort(terms.begin(), terms.end());
+        for (size_t pos = begin; pos < end; ++pos) {
+            const auto [term_id, term_freq] = terms[pos - begin];
+            partial.term_ids[pos] = term_id;
+            partial.term_freqs[pos] = term_freq;
+            partial.shards[term_id % shard_count].push_back({ term_id, first_ordinal + static_cast<int>(i), term_freq });
+        }
+    }
+}
+
+
+void SearchServer::AppendShardPostings(const std::vector<PartialIndex>& partials, size_t shard) {
+    // Slices come in ordinal order, so every posting is an append
+    for (const PartialIndex& partial : partials) {
+        for (const BatchPosting& posting : partial.shards[shard]) {
+            mutable_segment_.Add(posting.term_id, posting.ordinal, posting.term_freq);
+            ++document_freqs_[posting.term_id];
+            UpdateDocumentFreq(posting.term_id);
+        }
+    }
+}
+
+
+void SearchServer::AppendPartialDocuments(const std::vector<DocumentInput>& documents, const std::vector<PartialIndex>& partials) {
+    std::vector<uint32_t> term_ids;
+    std::vector<double> term_freqs;
+    for (const PartialIndex& partial : partials) {
+        for (size_t i = 0; i < partial.document_count; ++i) {
+            const auto begin = partial.offsets[i];
+            const auto end = partial.offsets[i + 1];
+            term_ids.assign(partial.term_ids.begin() + begin, partial.term_ids.begin() + end);
+            term_freqs.assign(partial.term_freqs.begin() + begin, partial.term_freqs.begin() + end);
+            const DocumentInput& document = documents[partial.first_document + i];
+            AppendDocument(document.id, document.status, ComputeAverageRating(document.ratings), term_ids, term_freqs);
+        }
+    }
+}
+
+
+CollectionStatistics& CollectionStatistics::operator+=(const CollectionStatistics& other) {
+    document_count += other.document_count;
+    for (const auto& [word, document_freq] : other.document_freqs) {
+        document_freqs[word] += document_freq;
+    }
+    return *this;
+}
+
+double CollectionStatistics::ComputeInverseDocumentFreq(std::string_view word) const {
+    // Same expression as the cached logarithms of SearchServer, so the ranking matches one server exactly
+    return std::log(document_count) - std::log(document_freqs.at(word));
+}
+
+
+std::vector<Document> SearchServer::FindTopDocumentsInCollection(const CollectionStatistics& statistics, std::string_view raw_query, const DocumentFilter& filter, size_t top_count) const {
+    QueryContext& context = GetQueryContext();
+    ParseQuery(raw_query, context.words_, context.query_);
+    SelectFilterDocuments(filter, context.candidates_);
+    FindAllDocuments(context, AcceptAll(), &statistics);
+    SelectTopDocuments(context.documents_, top_count);
+    return context.documents_;
+}
+
+
+CollectionStatistics SearchServer::GetQueryStatistics(std::string_view raw_query) const {
+    CollectionStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    for (std::string_view word : ParseQuery(raw_query).plus_words) {
+        const uint32_t term_id = FindTermId(word);
+        statistics.document_freqs[word] = term_id == NO_TERM ? 0 : static_cast<int>(document_freqs_[term_id]);
+    }
+    return statistics;
+}
+
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(GetQueryContext(), raw_query, status, top_count);
+}
+
+
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    ParseQuery(raw_query, context.words_, context.query_);
+    SelectStatusDocuments(status, context.candidates_);
+    FindAllDocuments(context, AcceptAll());
+    SelectTopDocuments(context.documents_, top_count);
+    return context.documents_;
+}
+
+
+std::vector<Document> SearchServer::FindTopDocuments(SearchMode mode, std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    if (mode == SearchMode::EXHAUSTIVE) {
+        return FindTopDocuments(raw_query, status, top_count);
+    }
+    QueryContext& context = GetQueryContext();
+    ParseQuery(raw_query, context.words_, context.query_);
+    SelectStatusDocuments(status, context.candidates_);
+    return FindTopDocumentsWand(context.query_, context.candidates_, AcceptAll(), top_count);
+}
+
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter, size_t top_count) const {
+    QueryContext& context = GetQueryContext();
+    ParseQuery(raw_query, context.words_, context.query_);
+    SelectFilterDocuments(filter, context.candidates_);
+    FindAllDocuments(context, AcceptAll());
+    SelectTopDocuments(context.documents_, top_count);
+    return context.documents_;
+}
+
+
+std::vector<Document> SearchServer::FindTopDocuments(SearchMode mode, std::string_view raw_query, const DocumentFilter& filter, size_t top_count) const {
+    if (mode == SearchMode::EXHAUSTIVE) {
+        return FindTopDocuments(raw_query, filter, top_count);
+    }
+    QueryContext& context = GetQueryContext();
+    ParseQuery(raw_query, context.words_, context.query_);
+    SelectFilterDocuments(filter, context.candidates_);
+    return FindTopDocumentsWand(context.query_, context.candidates_, AcceptAll(), top_count);
 }
 
 
@@ -55,7 +316,12 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query)
 
 
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return static_cast<int>(document_ids_.size());
+}
+
+
+bool SearchServer::HasDocument(int document_id) const {
+    return document_ids_.Contains(document_id);
 }
 
 
@@ -63,26 +329,25 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     // Empty result by initializing it with default constructed tuple
     Query query = ParseQuery(raw_query);
 
+    const int ordinal = document_ids_.At(document_id);
+    const DocumentStatus status = statuses_[ordinal];
+
     std::vector<std::string_view> matched_words;
-    for (const std::string_view& word : query.minus_words) {
-        if (word_to_id_freqs_.count(std::string(word)) == 0) {
-            continue;
-        }
-        if (word_to_id_freqs_.at(std::string(word)).count(document_id)) {
-            return { matched_words, documents_.at(document_id).status };
+    for (std::string_view word : query.minus_words) {
+        const uint32_t term_id = FindTermId(word);
+        if (term_id != NO_TERM && forward_index_.Contains(ordinal, term_id)) {
+            return { matched_words, status };
         }
     }
 
-    for (const std::string_view& word : query.plus_words) {
-        if (word_to_id_freqs_.count(std::string(word)) == 0) {
-            continue;
-        }
-        if (word_to_id_freqs_.at(std::string(word)).count(document_id)) {
-            matched_words.push_back(word);
+    for (std::string_view word : query.plus_words) {
+        const uint32_t term_id = FindTermId(word);
+        if (term_id != NO_TERM && forward_index_.Contains(ordinal, term_id)) {
+            matched_words.push_back(terms_[term_id]);
         }
     }
 
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, status };
 }
 
 
@@ -93,36 +358,31 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const {
     const auto& query = ParseQuery(std::execution::par, raw_query);
-    std::vector<std::string_view> matched_words{};
+    const int ordinal = document_ids_.At(document_id);
+    const DocumentStatus status = statuses_[ordinal];
+    const auto contains_document = [this, ordinal](std::string_view word) {
+        const uint32_t term_id = FindTermId(word);
+        return term_id != NO_TERM && forward_index_.Contains(ordinal, term_id);
+    };
 
-    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(),
-        [&](auto& word) {
-            return word_to_id_freqs_.at(std::string(word)).count(document_id);
-        })) {
-        return { matched_words, documents_.at(document_id).status };
+    std::vector<std::string_view> matched_words;
+    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), contains_document)) {
+        return { matched_words, status };
     }
 
-    matched_words.reserve(query.plus_words.size());
-    const auto& words_freqs = id_to_word_freqs_.at(document_id);
-
-    if (words_freqs.empty()) {
-        return { matched_words, documents_.at(document_id).status };
-    }    
-
-    std::for_each(std::execution::par, std::begin(words_freqs), std::end(words_freqs),
-        [&query, &matched_words](auto& wf) {
-            for (std::string_view str : query.plus_words) {
-                if (str == wf.first) {
-                    matched_words.push_back(str);
-                }
-            }
-        });
+    matched_words.resize(query.plus_words.size());
+    auto matched_end = std::copy_if(std::execution::par, query.plus_words.begin(), query.plus_words.end(),
+        matched_words.begin(), contains_document);
 
-    std::sort(matched_words.begin(), matched_words.end());
-    auto unique_p = std::unique(matched_words.begin(), matched_words.end());
-    matched_words.erase(unique_p, matched_words.end());
+    std::sort(matched_words.begin(), matched_end);
+    matched_end = std::unique(matched_words.begin(), matched_end);
+    matched_words.erase(matched_end, matched_words.end());
+    // The words are returned as views of the dictionary, which outlive the query text
+    for (std::string_view& word : matched_words) {
+        word = terms_[FindTermId(word)];
+    }
 
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, status };
 }
 
 
@@ -135,38 +395,405 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 
 
 void SearchServer::RemoveDocument(int document_id) {
-        if (id_to_word_freqs_.count(document_id) == 0) {
-            return;
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+
+void SearchServer::Flush() {
+    const int end_ordinal = static_cast<int>(ordinal_to_id_.size());
+    if (end_ordinal > mutable_segment_.GetFirstOrdinal()) {
+        mutable_segment_.Freeze(end_ordinal);
+        segments_.push_back(std::make_shared<const IndexSegment>(std::move(mutable_segment_)));
+        mutable_segment_ = IndexSegment(end_ordinal);
+        mutable_segment_.ResizeTerms(terms_.size());
+    }
+    UpdateSegments();
+}
+
+
+void SearchServer::WaitForMerges() {
+    while (merge_.valid()) {
+        merge_.wait();
+        UpdateSegments();
+    }
+}
+
+
+size_t SearchServer::GetSegmentCount() const {
+    return segments_.size() + 1;
+}
+
+
+void SearchServer::UpdateSegments() {
+    if (ordinal_to_id_.size() - mutable_segment_.GetFirstOrdinal() >= MUTABLE_SEGMENT_SIZE) {
+        Flush();
+        return;
+    }
+    if (merge_.valid() && merge_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        const auto first = segments_.begin() + merge_first_;
+        *first = merge_.get();
+        segments_.erase(first + 1, first + merge_count_);
+        merge_ = {};
+    }
+    StartMerge();
+}
+
+
+void SearchServer::StartMerge() {
+    if (merge_.valid()) {
+        return;
+    }
+    // The first run of MERGE_FACTOR adjacent segments of one tier, the oldest segments are the largest
+    for (size_t first = 0; first + MERGE_FACTOR <= segments_.size(); ++first) {
+        const size_t tier = GetSegmentTier(segments_[first]->GetDocumentCount());
+        size_t count = 1;
+        while (count < MERGE_FACTOR && GetSegmentTier(segments_[first + count]->GetDocumentCount()) == tier) {
+            ++count;
         }
-        for (const auto& [word, freq] : id_to_word_freqs_.at(document_id)) {
-            word_to_id_freqs_.at(word).erase(document_id);
+        if (count < MERGE_FACTOR) {
+            continue;
+        }
+
+        std::vector<std::shared_ptr<const IndexSegment>> segments(segments_.begin() + first, segments_.begin() + first + count);
+        // Postings of the documents removed so far are dropped by the merge
+        DocumentBitmap removed;
+        removed.Assign(ordinal_to_id_.size());
+        for (int ordinal : tombstones_) {
+            removed.Set(ordinal);
         }
-        id_to_word_freqs_.erase(document_id);
-        documents_.erase(document_id);
-        document_ids_.erase(std::find(document_ids_.begin(), document_ids_.end(), document_id));
+        merge_ = std::async(std::launch::async, [segments = std::move(segments), removed = std::move(removed)]() {
+            std::vector<const IndexSegment*> sources;
+            for (const auto& segment : segments) {
+                sources.push_back(segment.get());
+            }
+            return std::make_shared<const IndexSegment>(IndexSegment::Merge(sources, removed));
+            }).share();
+        merge_first_ = first;
+        merge_count_ = count;
+        return;
+    }
 }
 
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const
-{
-    static std::map<std::string_view, double> result;
-    result.clear();    
-    for (const auto& [word, doc] : word_to_id_freqs_) {
-        auto it = doc.find(document_id);
-        if (it != doc.end())
-        {
-            result[word] = it->second;
+size_t SearchServer::GetSegmentTier(size_t document_count) {
+    size_t tier = 0;
+    for (size_t size = MUTABLE_SEGMENT_SIZE * MERGE_FACTOR; document_count >= size; size *= MERGE_FACTOR) {
+        ++tier;
+    }
+    return tier;
+}
+
+
+bool SearchServer::HasTombstones(const IndexSegment& segment) const {
+    const auto it = std::lower_bound(tombstones_.begin(), tombstones_.end(), segment.GetFirstOrdinal());
+    return it != tombstones_.end() && *it < segment.GetEndOrdinal();
+}
+
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    RemoveDocuments(std::execution::seq, document_ids);
+}
+
+
+void SearchServer::Compact() {
+    Compact(std::execution::seq);
+}
+
+
+bool SearchServer::TombstoneDocument(int document_id) {
+    const int ordinal = document_ids_.Find(document_id);
+    if (ordinal == DocumentIds::NO_ORDINAL) {
+        return false;
+    }
+    const DocumentTerms terms = forward_index_.Get(ordinal);
+    for (size_t i = 0; i < terms.size; ++i) {
+        --document_freqs_[terms.term_ids[i]];
+        UpdateDocumentFreq(terms.term_ids[i]);
+    }
+
+    status_documents_[static_cast<size_t>(std::as_const(statuses_)[ordinal])].Reset(ordinal);
+    live_documents_.Reset(ordinal);
+    tombstones_.push_back(ordinal);
+    document_ids_.Remove(document_id);
+    log_document_count_ = std::log(GetDocumentCount());
+    return true;
+}
+
+
+bool SearchServer::NeedsCompaction() const {
+    return tombstones_.size() * 4 >= document_ids_.size() + tombstones_.size();
+}
+
+
+namespace {
+
+    enum SnapshotSection : uint32_t {
+        STOP_WORD_OFFSETS = 1,
+        STOP_WORD_BYTES,
+        TERM_OFFSETS,
+        TERM_BYTES,
+        TERM_HASHES,
+        TERM_SLOTS,
+        DOCUMENT_IDS,
+        DOCUMENT_STATUSES,
+        DOCUMENT_RATINGS,
+        FORWARD_OFFSETS,
+        FORWARD_TERM_IDS,
+        FORWARD_TERM_FREQS,
+        FORWARD_WORD_ORDER,
+        POSTING_OFFSETS,
+        // Postings::Columns in their ForEach order take the ids from here on
+        POSTING_COLUMNS
+    };
+
+    // Strings go back to back into bytes, string i is [offsets[i], offsets[i + 1])
+    template <typename StringContainer>
+    void AppendSnapshotStrings(const StringContainer& strings, std::vector<uint64_t>& offsets, std::vector<char>& bytes) {
+        offsets.push_back(0);
+        for (std::string_view str : strings) {
+            bytes.insert(bytes.end(), str.begin(), str.end());
+            offsets.push_back(bytes.size());
+        }
+    }
+
+    // Offsets must start at 0 and never decrease, the last one being the end of the values
+    void CheckSnapshotOffsets(const SnapshotArray<uint64_t>& offsets, size_t value_count) {
+        if (offsets.size == 0 || offsets[0] != 0 || offsets[offsets.size - 1] != value_count
+            || !std::is_sorted(offsets.begin(), offsets.end())) {
+            throw std::runtime_error("Snapshot is damaged"s);
+        }
+    }
+
+    // Calls function(str) for every string stored by AppendSnapshotStrings
+    template <typename Function>
+    void ForEachSnapshotString(const SnapshotReader& reader, uint32_t offsets_id, uint32_t bytes_id, Function function) {
+        const auto offsets = reader.GetSection<uint64_t>(offsets_id);
+        const auto bytes = reader.GetSection<char>(bytes_id);
+        CheckSnapshotOffsets(offsets, bytes.size);
+        for (size_t i = 0; i + 1 < offsets.size; ++i) {
+            function(std::string_view(bytes.data + offsets[i], offsets[i + 1] - offsets[i]));
+        }
+    }
+
+    // Column viewing the section where it lies
+    template <typename T>
+    MappedVector<T> ViewSnapshotSection(const SnapshotReader& reader, uint32_t id) {
+        const auto section = reader.GetSection<T>(id);
+        return MappedVector<T>::View(section.data, section.size);
+    }
+
+}
+
+
+void SearchServer::SaveSnapshot(const std::string& path) const {
+    std::vector<uint64_t> stop_word_offsets, term_offsets;
+    std::vector<char> stop_word_bytes, term_bytes;
+    AppendSnapshotStrings(stop_words_, stop_word_offsets, stop_word_bytes);
+    AppendSnapshotStrings(terms_.GetWords(), term_offsets, term_bytes);
+
+    // Live documents get consecutive ordinals in the old order, so ties are still broken the same way
+    std::vector<int> new_ordinals(ordinal_to_id_.size(), -1);
+    std::vector<int> document_ids, ratings;
+    std::vector<DocumentStatus> statuses;
+    std::vector<uint64_t> forward_offsets = { 0 };
+    std::vector<uint32_t> forward_term_ids;
+    std::vector<TermFreqCodec::Stored> forward_term_freqs;
+    std::vector<uint32_t> forward_word_order;
+    for (size_t ordinal = 0; ordinal < ordinal_to_id_.size(); ++ordinal) {
+        if (!live_documents_.Test(static_cast<int>(ordinal))) {
+            continue;
+        }
+        new_ordinals[ordinal] = static_cast<int>(document_ids.size());
+        document_ids.push_back(ordinal_to_id_[ordinal]);
+        statuses.push_back(statuses_[ordinal]);
+        ratings.push_back(ratings_[ordinal]);
+        const DocumentTerms terms = forward_index_.Get(static_cast<int>(ordinal));
+        forward_term_ids.insert(forward_term_ids.end(), terms.term_ids, terms.term_ids + terms.size);
+        forward_term_freqs.insert(forward_term_freqs.end(), terms.term_freqs, terms.term_freqs + terms.size);
+        forward_word_order.insert(forward_word_order.end(), terms.word_order, terms.word_order + terms.size);
+        forward_offsets.push_back(forward_term_ids.size());
+    }
+
+    // The live postings of every term are merged across segments into one list, and the lists are
+    // stored back to back in the layout of the build, so a load can view them where they lie
+    std::vector<uint64_t> posting_offsets = { 0 };
+    Postings::Columns posting_columns;
+    for (uint32_t term_id = 0; term_id < terms_.size(); ++term_id) {
+        Postings merged;
+        ForEachPostings(term_id, [&](const Postings& postings) {
+            postings.ForEach([&](int ordinal, double term_freq) {
+                if (new_ordinals[ordinal] >= 0) {
+                    merged.Add(new_ordinals[ordinal], term_freq);
+                }
+            });
+        });
+        merged.AppendTo(posting_columns);
+        posting_offsets.push_back(posting_offsets.back() + merged.size());
+    }
+
+    SnapshotWriter writer;
+    writer.AddSection(STOP_WORD_OFFSETS, stop_word_offsets);
+    writer.AddSection(STOP_WORD_BYTES, stop_word_bytes);
+    writer.AddSection(TERM_OFFSETS, term_offsets);
+    writer.AddSection(TERM_BYTES, term_bytes);
+    writer.AddSection(TERM_HASHES, terms_.GetHashes());
+    writer.AddSection(TERM_SLOTS, terms_.GetSlots());
+    writer.AddSection(DOCUMENT_IDS, document_ids);
+    writer.AddSection(DOCUMENT_STATUSES, statuses);
+    writer.AddSection(DOCUMENT_RATINGS, ratings);
+    writer.AddSection(FORWARD_OFFSETS, forward_offsets);
+    writer.AddSection(FORWARD_TERM_IDS, forward_term_ids);
+    writer.AddSection(FORWARD_TERM_FREQS, forward_term_freqs);
+    writer.AddSection(FORWARD_WORD_ORDER, forward_word_order);
+    writer.AddSection(POSTING_OFFSETS, posting_offsets);
+    uint32_t column_id = POSTING_COLUMNS;
+    posting_columns.ForEach([&](const auto& column) {
+        writer.AddSection(column_id++, column);
+    });
+    writer.Write(path, SNAPSHOT_VERSION);
+}
+
+
+SearchServer SearchServer::LoadSnapshot(const std::string& path, bool check_sections) {
+    const auto reader = std::make_shared<const SnapshotReader>(path, SNAPSHOT_VERSION, check_sections);
+    SearchServer server;
+    server.snapshot_ = reader;
+
+    StringSet stop_words;
+    ForEachSnapshotString(*reader, STOP_WORD_OFFSETS, STOP_WORD_BYTES, [&](std::string_view word) {
+        stop_words.emplace_hint(stop_words.end(), word);
+    });
+    server.stop_words_ = StopWordFilter(stop_words);
+
+    // Words and the hash table are taken as saved, no word is hashed or copied
+    std::vector<std::string_view> words;
+    ForEachSnapshotString(*reader, TERM_OFFSETS, TERM_BYTES, [&](std::string_view word) {
+        words.push_back(word);
+    });
+    const size_t term_count = words.size();
+    try {
+        server.terms_ = TermDictionary(std::move(words), ViewSnapshotSection<uint64_t>(*reader, TERM_HASHES),
+            ViewSnapshotSection<uint32_t>(*reader, TERM_SLOTS));
+    }
+    catch (const std::invalid_argument&) {
+        throw std::runtime_error("Snapshot is damaged"s);
+    }
+
+    server.ordinal_to_id_ = ViewSnapshotSection<int>(*reader, DOCUMENT_IDS);
+    server.statuses_ = ViewSnapshotSection<DocumentStatus>(*reader, DOCUMENT_STATUSES);
+    server.ratings_ = ViewSnapshotSection<int>(*reader, DOCUMENT_RATINGS);
+    const auto forward_offsets = reader->GetSection<uint64_t>(FORWARD_OFFSETS);
+    auto forward_term_ids = ViewSnapshotSection<uint32_t>(*reader, FORWARD_TERM_IDS);
+    auto forward_term_freqs = ViewSnapshotSection<TermFreqCodec::Stored>(*reader, FORWARD_TERM_FREQS);
+    auto forward_word_order = ViewSnapshotSection<uint32_t>(*reader, FORWARD_WORD_ORDER);
+    const size_t document_count = server.ordinal_to_id_.size();
+    if (server.statuses_.size() != document_count || server.ratings_.size() != document_count
+        || forward_offsets.size != document_count + 1 || forward_term_freqs.size() != forward_term_ids.size()
+        || forward_word_order.size() != forward_term_ids.size()) {
+        throw std::runtime_error("Snapshot is damaged"s);
+    }
+    CheckSnapshotOffsets(forward_offsets, forward_term_ids.size());
+    server.forward_index_ = ForwardIndex(std::move(forward_term_ids), std::move(forward_term_freqs), std::move(forward_word_order),
+        MappedVector<uint64_t>::View(forward_offsets.data, forward_offsets.size));
+    // Searches index the dictionary and the per-term columns with these ids without checks
+    if (!server.forward_index_.HasValidTerms(term_count)) {
+        throw std::runtime_error("Snapshot is damaged"s);
+    }
+
+    // Only the lookups by id and by status are built, one step per document
+    const MappedVector<int>& document_ids = server.ordinal_to_id_;
+    const MappedVector<DocumentStatus>& statuses = server.statuses_;
+    for (DocumentBitmap& documents : server.status_documents_) {
+        documents.Resize(document_count);
+    }
+    server.live_documents_.Resize(document_count);
+    for (size_t i = 0; i < document_count; ++i) {
+        const int ordinal = static_cast<int>(i);
+        const size_t status = static_cast<size_t>(statuses[i]);
+        if (document_ids[i] < 0 || status >= DOCUMENT_STATUS_COUNT || !server.document_ids_.Add(document_ids[i], ordinal)) {
+            throw std::runtime_error("Snapshot is damaged"s);
+        }
+        server.status_documents_[status].Set(ordinal);
+        server.live_documents_.Set(ordinal);
+    }
+
+    // Every list views its part of the columns, the size of a list is the document frequency of its term
+    const auto posting_offsets = reader->GetSection<uint64_t>(POSTING_OFFSETS);
+    Postings::Columns columns;
+    uint32_t column_id = POSTING_COLUMNS;
+    columns.ForEach([&](auto& column) {
+        using Column = std::decay_t<decltype(column)>;
+        column = ViewSnapshotSection<typename Column::value_type>(*reader, column_id++);
+    });
+    if (posting_offsets.size != term_count + 1) {
+        throw std::runtime_error("Snapshot is damaged"s);
+    }
+    CheckSnapshotOffsets(posting_offsets, columns.term_freqs.size());
+    server.document_freqs_.resize(term_count);
+    server.log_document_freqs_.resize(term_count);
+    std::vector<uint32_t> term_ids;
+    std::vector<Postings> lists;
+    Postings::ColumnPosition position;
+    for (uint32_t term_id = 0; term_id < term_count; ++term_id) {
+        const uint64_t size = posting_offsets[term_id + 1] - posting_offsets[term_id];
+        if (size > document_count) {
+            throw std::runtime_error("Snapshot is damaged"s);
+        }
+        server.document_freqs_[term_id] = static_cast<uint32_t>(size);
+        server.UpdateDocumentFreq(term_id);
+        if (size == 0) {
+            continue;
+        }
+        try {
+            lists.push_back(Postings::View(columns, static_cast<size_t>(size), position));
+        }
+        catch (const std::out_of_range&) {
+            throw std::runtime_error("Snapshot is damaged"s);
+        }
+        // Searches index bitmaps and metadata columns with the ordinals and rely on their order
+        if (!lists.back().HasValidDocumentIds(static_cast<int>(document_count))) {
+            throw std::runtime_error("Snapshot is damaged"s);
         }
-        else continue;
-    }        return result;
+        term_ids.push_back(term_id);
+    }
+
+    // All postings form one frozen segment, new documents go to a mutable one after it
+    if (document_count > 0) {
+        server.segments_.push_back(std::make_shared<const IndexSegment>(
+            IndexSegment::FromLists(0, static_cast<int>(document_count), std::move(term_ids), std::move(lists))));
+        server.log_document_count_ = std::log(server.GetDocumentCount());
+    }
+    server.mutable_segment_ = IndexSegment(static_cast<int>(document_count));
+    server.mutable_segment_.ResizeTerms(term_count);
+    return server;
+}
+
+
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const
+{
+    const int ordinal = document_ids_.Find(document_id);
+    if (ordinal == DocumentIds::NO_ORDINAL) {
+        return {};
+    }
+    return WordFrequencies(terms_.GetWords(), forward_index_.Get(ordinal));
 }
 
 
-std::set<int>::const_iterator SearchServer::begin() const {
+DocumentTerms SearchServer::GetDocumentTerms(int document_id) const
+{
+    const int ordinal = document_ids_.Find(document_id);
+    if (ordinal == DocumentIds::NO_ORDINAL) {
+        return {};
+    }
+    return forward_index_.Get(ordinal);
+}
+
+
+DocumentIds::const_iterator SearchServer::begin() const {
     return document_ids_.begin();
 }
 
-std::set<int>::const_iterator SearchServer::end() const {
+DocumentIds::const_iterator SearchServer::end() const {
     return document_ids_.end();
 }
 
@@ -181,22 +808,19 @@ bool SearchServer::IsValidWord(std::string_view word) {
 
 //    -,  
 bool SearchServer::IsStopWord(std::string_view word) const {
-    return stop_words_.count(std::string(word)) > 0;
+    return stop_words_.Contains(word);
 }
 
 
 //    ,  -,  
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("Text contain invalid symbols"s);
-        }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
-        }
+void SearchServer::SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const {
+    // The split checks every byte, so the words need no validation of their own
+    if (!SplitIntoValidWords(text, words)) {
+        throw std::invalid_argument("Text contain invalid symbols"s);
     }
-    return words;
+    words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) {
+        return IsStopWord(word);
+        }), words.end());
 }
 
 
@@ -211,9 +835,71 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 }
 
 
+QueryContext& SearchServer::GetQueryContext() {
+    thread_local QueryContext context;
+    return context;
+}
+
+void SearchServer::SelectAllDocuments(DocumentBitmap& candidates) const {
+    candidates = live_documents_;
+}
+
+void SearchServer::SelectStatusDocuments(DocumentStatus status, DocumentBitmap& candidates) const {
+    candidates = status_documents_[static_cast<size_t>(status)];
+}
+
+void SearchServer::SelectFilterDocuments(const DocumentFilter& filter, DocumentBitmap& candidates) const {
+    filter.Evaluate({ ordinal_to_id_, ratings_, status_documents_.data() }, candidates);
+    // Range leaves cover every ordinal, removed documents included
+    candidates &= live_documents_;
+}
+
+void SearchServer::ExcludeMinusWords(const Query& query, DocumentBitmap& candidates) const {
+    for (std::string_view word : query.minus_words) {
+        const uint32_t term_id = FindTermId(word);
+        if (term_id != NO_TERM) {
+            ForEachPostings(term_id, [&candidates](const Postings& postings) {
+                postings.ForEach([&candidates](int ordinal, double) {
+                    candidates.Reset(ordinal);
+                    });
+                });
+        }
+    }
+}
+
+void SearchServer::SelectTopDocuments(std::vector<Document>& documents, size_t top_count) {
+    const auto by_relevance = [](const Document& lhs, const Document& rhs) {
+        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+            return lhs.rating > rhs.rating;
+        }
+        else {
+            return lhs.relevance > rhs.relevance;
+        }
+    };
+    // partial_sort keeps a heap of top_count elements: O(n log k) instead of sorting every match
+    if (documents.size() > top_count) {
+        std::partial_sort(documents.begin(), documents.begin() + top_count, documents.end(), by_relevance);
+        documents.resize(top_count);
+    }
+    else {
+        std::sort(documents.begin(), documents.end(), by_relevance);
+    }
+}
+
+
 SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
+    std::vector<std::string_view> words;
     Query result;
-    for (std::string_view& word : SplitIntoWords(text)) {
+    ParseQuery(text, words, result);
+    return result;
+}
+
+
+void SearchServer::ParseQuery(std::string_view text, std::vector<std::string_view>& words, Query& result) const {
+    SplitIntoWords(text, words);
+    result.minus_words.clear();
+    result.plus_words.clear();
+    for (std::string_view word : words) {
         const auto& query_word = ParseQueryWord(word);
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
@@ -232,8 +918,6 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text) const {
     std::sort(result.plus_words.begin(), result.plus_words.end());
     auto plus_word = std::unique(result.plus_words.begin(), result.plus_words.end());
     result.plus_words.erase(plus_word, result.plus_words.end());
-    
-    return result;
 }
 
 
@@ -259,8 +943,35 @@ SearchServer::Query SearchServer::ParseQuery(std::execution::sequenced_policy po
 }
 
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_id_freqs_.at(std::string(word)).size());
+uint32_t SearchServer::InternTerm(std::string_view word) {
+    const uint32_t term_id = terms_.Intern(word);
+    if (term_id == document_freqs_.size()) {
+        mutable_segment_.ResizeTerms(terms_.size());
+        document_freqs_.push_back(0);
+        log_document_freqs_.push_back(0.0);
+    }
+    return term_id;
+}
+
+
+uint32_t SearchServer::FindTermId(std::string_view word) const {
+    const uint32_t term_id = terms_.Find(word);
+    if (term_id == TermDictionary::NO_TERM || document_freqs_[term_id] == 0) {
+        return NO_TERM;
+    }
+    return term_id;
+}
+
+
+double SearchServer::ComputeWordInverseDocumentFreq(uint32_t term_id) const {
+    return log_document_count_ - log_document_freqs_[term_id];
+}
+
+
+void SearchServer::UpdateDocumentFreq(uint32_t term_id) {
+    const uint32_t document_freq = document_freqs_[term_id];
+    // A term without live documents is never scored, so its entry is not used
+    log_document_freqs_[term_id] = document_freq == 0 ? 0.0 : std::log(document_freq);
 }
 
 
@@ -11,11 +11,34 @@
 #include <execution>
 #include <tuple>
 #include <mutex>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+#include <climits>
+#include <limits>
+#include <type_traits>
+#include <array>
+#include <exception>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <memory>
+#include <memory_resource>
 
 #include "string_processing.h"
 #include "document.h"
 #include "log_duration.h"
 #include "concurrent_map.h"
+#include "index_segment.h"
+#include "score_accumulator.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
+#include "forward_index.h"
+#include "term_dictionary.h"
+#include "document_ids.h"
+#include "query_context.h"
+#include "stop_word_filter.h"
+#include "mapped_vector.h"
 
 using namespace std::string_literals;
 
@@ -24,19 +47,35 @@ using namespace std::string_literals;
 // Search_Server start //
 //---------------------//
 
+class SnapshotReader;
+
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double EPSILON = 1e-6;
 
-enum class DocumentStatus {
-    ACTUAL,
-    IRRELEVANT,
-    BANNED,
-    REMOVED
+// EXHAUSTIVE scores every matching document, WAND skips documents and posting blocks
+// whose score upper bound cannot reach the current top. Both return the same documents.
+enum class SearchMode {
+    EXHAUSTIVE,
+    WAND
+};
+
+// Document counts of a collection split across several servers, so that each of them ranks its
+// documents with the IDF of the whole collection. Holds the words of one query only.
+struct CollectionStatistics {
+    int document_count = 0;
+    std::map<std::string_view, int> document_freqs;
+
+    CollectionStatistics& operator+=(const CollectionStatistics& other);
+
+    // The word must be in document_freqs with a non-zero count
+    double ComputeInverseDocumentFreq(std::string_view word) const;
 };
 
 //   (  )   : {ID  ;    -}
 class SearchServer {
 public:
+    static const uint32_t NO_TERM = UINT32_MAX;
+
     // Defines an invalid document id
     // You can refer this constant as SearchServer::INVALID_DOCUMENT_ID
     SearchServer() = default;
@@ -50,46 +89,123 @@ public:
 
     void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Adds the documents as if AddDocument was called for each of them in order, but a parallel policy
+    // splits the batch into slices tokenized and inverted on separate threads. The ids and the texts are
+    // validated first, so if anything throws no document of the batch is added.
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+    template<typename Policy>
+    void AddDocuments(Policy&& policy, const std::vector<DocumentInput>& documents);
+
+    // Throw std::invalid_argument where AddDocument or AddDocuments would, without changing the server
+    void CheckDocument(int document_id, std::string_view document) const;
+    void CheckDocuments(const std::vector<DocumentInput>& documents) const;
+
     //  -5      : {id, }
+    // top_count sets how many documents to return instead of MAX_RESULT_DOCUMENT_COUNT
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
     std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
     template <typename DocumentPredicate, typename Policy>
-    std::vector<Document> FindTopDocuments(Policy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(Policy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
     template <typename Policy>
-    std::vector<Document> FindTopDocuments(Policy&& policy, std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(Policy&& policy, std::string_view raw_query, DocumentStatus status, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
     template <typename Policy>
     std::vector<Document> FindTopDocuments(Policy&& policy, std::string_view raw_query) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(SearchMode mode, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(SearchMode mode, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    // The filter is evaluated over the metadata columns once per query instead of once per posting
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename Policy>
+    std::vector<Document> FindTopDocuments(Policy&& policy, std::string_view raw_query, const DocumentFilter& filter, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(SearchMode mode, std::string_view raw_query, const DocumentFilter& filter, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    // Sequential searches in the buffers of context. The result belongs to the context and stays valid
+    // until its next search, so a caller reusing one context runs queries without heap allocations.
+    template <typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    const std::vector<Document>& FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Ranks by the IDF of a larger collection this server is a part of, see ShardedSearchServer
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsInCollection(const CollectionStatistics& statistics, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocumentsInCollection(const CollectionStatistics& statistics, std::string_view raw_query, const DocumentFilter& filter, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Document count and document frequencies of the plus words of the query in this server
+    CollectionStatistics GetQueryStatistics(std::string_view raw_query) const;
+
+    // Leaves the top_count best documents ordered by relevance, then by rating
+    static void SelectTopDocuments(std::vector<Document>& documents, size_t top_count);
 
     int GetDocumentCount() const;
+    bool HasDocument(int document_id) const;
 
     //      ,  
+    // Matched words are views of the dictionary of the server and stay valid while it lives
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy policy, std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const;
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Words of the document with their TF in alphabetical order, empty if there is no such document.
+    // The result views the server and is valid until the server changes.
+    WordFrequencies GetWordFrequencies(int document_id) const;
+    // Ascending term ids of the document with their TF, empty if there is no such document.
+    // Equal sets of words give equal sequences. Valid until the server changes.
+    DocumentTerms GetDocumentTerms(int document_id) const;
 
-    [[nodiscard]] std::set<int>::const_iterator begin() const;
-    [[nodiscard]] std::set<int>::const_iterator end() const;
+    [[nodiscard]] DocumentIds::const_iterator begin() const;
+    [[nodiscard]] DocumentIds::const_iterator end() const;
 
     /*int GetDocumentId(int index) const;*/
 
+    // New documents go to a mutable segment that is frozen once it holds MUTABLE_SEGMENT_SIZE of them.
+    // MERGE_FACTOR adjacent frozen segments of one size tier are merged on a background thread into
+    // a segment of the next tier, queries read every segment.
+    static const size_t MUTABLE_SEGMENT_SIZE = 16384;
+    static const size_t MERGE_FACTOR = 4;
+
+    // Freezes the mutable segment now, if it has documents
+    void Flush();
+    // Blocks until no background merge is running and installs the merged segments
+    void WaitForMerges();
+    // Segments a query reads, the mutable one included
+    size_t GetSegmentCount() const;
+
+    // Removed documents are skipped by searches at once, their postings are erased by a later
+    // compaction that runs when tombstones reach a quarter of the indexed documents
     void RemoveDocument(int document_id);
     template<typename Policy>
     void RemoveDocument(Policy&& policy, int document_id);
 
+    // Removes every document of the batch and compacts the postings at most once, unknown ids are ignored
+    void RemoveDocuments(const std::vector<int>& document_ids);
+    template<typename Policy>
+    void RemoveDocuments(Policy&& policy, const std::vector<int>& document_ids);
+
+    // Erases the postings of all removed documents now, a parallel policy rewrites posting lists concurrently
+    void Compact();
+    template<typename Policy>
+    void Compact(Policy&& policy);
+
+    // Binary snapshots: stop words, the term dictionary with its hash table, postings, the forward index
+    // and the metadata columns are saved as flat arrays. LoadSnapshot maps the file and serves the arrays
+    // where they lie, the postings as one frozen segment, so it neither tokenizes text nor copies a posting.
+    // Whatever is changed later is copied first. Removed documents are left out.
+    // Files of another SNAPSHOT_VERSION, another TF codec or another posting layout are rejected.
+    static constexpr uint32_t SNAPSHOT_VERSION = 3;
+
+    // Throws std::runtime_error if the file cannot be written
+    void SaveSnapshot(const std::string& path) const;
+    // The sizes of the arrays are checked, and so are the ordinals of the postings and the term ids of
+    // the forward index, which must ascend and stay in range. check_sections also verifies the
+    // checksum of every section, which reads the whole file.
+    // Throws std::runtime_error if the file cannot be read or is damaged
+    static SearchServer LoadSnapshot(const std::string& path, bool check_sections = false);
+
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-    };
+    using Postings = IndexSegment::Postings;
 
-    struct Query {
-        std::vector<std::string_view> minus_words;
-        std::vector<std::string_view> plus_words;
-    };
+    using Query = ParsedQuery;
 
     struct QueryWord {
         std::string_view data;
@@ -97,12 +213,70 @@ private:
         bool is_stop;
     };
 
-    StringSet stop_words_;
-    StringSet document_words_;
-    std::map<std::string, std::map<int, double>, std::less<>> word_to_id_freqs_;
-    std::map<int, std::map<std::string, double>> id_to_word_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::set<int> document_ids_;
+    // Posting of an AddDocuments batch waiting to be appended to its list
+    struct BatchPosting {
+        uint32_t term_id;
+        int ordinal;
+        double term_freq;
+    };
+
+    // Slice of an AddDocuments batch inverted by one thread with its own dictionary
+    struct PartialIndex {
+        size_t first_document = 0;
+        size_t document_count = 0;
+        // Words of the slice, local term ids index this
+        std::vector<std::string_view> terms;
+        // Distinct term ids of each document with their TF, document i owns [offsets[i], offsets[i + 1]).
+        // Local ids at first, then global ascending ones once the words are interned.
+        std::vector<uint32_t> term_ids;
+        std::vector<double> term_freqs;
+        std::vector<size_t> offsets;
+        // Global id of every local one
+        std::vector<uint32_t> global_ids;
+        // Postings of the slice split by term_id % shards.size(), so shards are appended on separate threads
+        std::vector<std::vector<BatchPosting>> shards;
+        // Set instead of throwing, since exceptions must not leave a parallel algorithm
+        std::exception_ptr error;
+    };
+
+    // Predicate of searches whose candidate bitmap already holds the whole filter
+    struct AcceptAll {
+        bool operator()(int, DocumentStatus, int) const {
+            return true;
+        }
+    };
+
+    // Mapped snapshot the server was loaded from, if any. The columns below may view its sections,
+    // so it is declared first and released last, once no copy of the server uses it.
+    std::shared_ptr<const SnapshotReader> snapshot_;
+    StopWordFilter stop_words_;
+    // Every term is interned once, term ids index the per-term columns below and the postings
+    TermDictionary terms_;
+    // Postings hold dense document ordinals assigned in order of addition, so they only grow at the end.
+    // Frozen segments are in ordinal order and shared with copies of the server and with merges.
+    std::vector<std::shared_ptr<const IndexSegment>> segments_;
+    IndexSegment mutable_segment_;
+    // Background merge that replaces merge_count_ segments from merge_first_ on
+    std::shared_future<std::shared_ptr<const IndexSegment>> merge_;
+    size_t merge_first_ = 0;
+    size_t merge_count_ = 0;
+    // IDF = log(N) - log(df): adding or removing a document refreshes log(df) of its own terms only.
+    // df counts live documents, postings of removed ones stay until compaction
+    std::vector<uint32_t> document_freqs_;
+    std::vector<double> log_document_freqs_;
+    double log_document_count_ = 0.0;
+    // Ordinals of the live documents by id
+    DocumentIds document_ids_;
+    // Columns indexed by ordinal; ordinals of removed documents are never reused
+    MappedVector<int> ordinal_to_id_;
+    MappedVector<DocumentStatus> statuses_;
+    MappedVector<int> ratings_;
+    ForwardIndex forward_index_;
+    // Ordinals of the documents with each status, so a status search needs no metadata
+    std::array<DocumentBitmap, DOCUMENT_STATUS_COUNT> status_documents_;
+    DocumentBitmap live_documents_;
+    // Removed documents whose postings are not erased yet
+    std::vector<int> tombstones_;
 
     // A valid word must not contain special characters
     static bool IsValidWord(const std::string_view word);
@@ -111,27 +285,96 @@ private:
     bool IsStopWord(std::string_view word) const;
 
     //    ,  -,  
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
+    // Words are views of the text and replace the contents of words, which callers reuse across documents
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    // Throws if the id is negative or already added
+    void CheckNewDocumentId(int document_id) const;
+    // Same for every document of a batch, which must not repeat an id either
+    void CheckNewDocumentIds(const std::vector<DocumentInput>& documents) const;
+
+    // Sorts the term ids of a document and leaves each once, with TF = occurrences / word count
+    static void CountTerms(std::vector<uint32_t>& term_ids, std::vector<double>& term_freqs);
+
+    // Appends the document with the next ordinal without touching postings, term_ids are ascending and unique
+    void AppendDocument(int document_id, DocumentStatus status, int rating,
+        const std::vector<uint32_t>& term_ids, const std::vector<double>& term_freqs);
+
+    // AddDocuments runs these steps in order, the ones taking a single slice or shard run in parallel
+    void BuildPartialIndex(const std::vector<DocumentInput>& documents, PartialIndex& partial) const;
+    void InternPartialTerms(std::vector<PartialIndex>& partials);
+    static void SortPartialIndex(PartialIndex& partial, int first_ordinal, size_t shard_count);
+    void AppendShardPostings(const std::vector<PartialIndex>& partials, size_t shard);
+    void AppendPartialDocuments(const std::vector<DocumentInput>& documents, const std::vector<PartialIndex>& partials);
+
+    // Context of the calling thread for sequential searches, so queries running in parallel do not share one.
+    // Queries that wait on parallel work keep their own buffers, since the thread may pick up another query.
+    static QueryContext& GetQueryContext();
+
+    void SelectAllDocuments(DocumentBitmap& candidates) const;
+    void SelectStatusDocuments(DocumentStatus status, DocumentBitmap& candidates) const;
+    void SelectFilterDocuments(const DocumentFilter& filter, DocumentBitmap& candidates) const;
+
+    // Clears the bit of every document containing a minus word, so it is skipped before scoring
+    void ExcludeMinusWords(const Query& query, DocumentBitmap& candidates) const;
+
     // Empty result by initializing it with default constructed QueryWord
     QueryWord ParseQueryWord(std::string_view text) const;
 
 
     //  set   ( )  -
     Query ParseQuery(std::string_view text) const;
+    // Splits the text into words and parses them into query, reusing the capacity of both
+    void ParseQuery(std::string_view text, std::vector<std::string_view>& words, Query& query) const;
     Query ParseQuery(std::execution::parallel_policy policy, std::string_view text) const;
     Query ParseQuery(std::execution::sequenced_policy policy, std::string_view text) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    // Returns the term id, adding the word to the dictionary if it is new
+    uint32_t InternTerm(std::string_view word);
+
+    // NO_TERM if no live document contains the word
+    uint32_t FindTermId(std::string_view word) const;
+
+    // Reads the cached logarithms, the term must have live documents
+    double ComputeWordInverseDocumentFreq(uint32_t term_id) const;
+
+    // Refreshes the cached log(df) of the term after its document frequency changed
+    void UpdateDocumentFreq(uint32_t term_id);
+
+    // Calls function(postings) for the list of the term in every segment that has it, in ordinal order
+    template <typename Function>
+    void ForEachPostings(uint32_t term_id, Function function) const;
+
+    // Flushes a full mutable segment, installs a finished merge and starts the next one; never blocks
+    void UpdateSegments();
+    void StartMerge();
+    static size_t GetSegmentTier(size_t document_count);
+    // Whether a tombstone falls into the ordinals of the segment, tombstones_ must be sorted
+    bool HasTombstones(const IndexSegment& segment) const;
+
+    // Hides the document from searches and leaves a tombstone, false if there is no such document
+    bool TombstoneDocument(int document_id);
+    bool NeedsCompaction() const;
 
     //      id  
+    // Only candidates are scored, minus words are cleared from them first
     template <typename DocumentPredicate, typename Policy>
-    std::vector<Document> FindAllDocuments(Policy&& policy, const Query& query_words, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindAllDocuments(Policy&& policy, const Query& query_words, DocumentBitmap& candidates, DocumentPredicate document_predicate) const;
+    // Scores the candidates of the parsed query of context into its documents.
+    // IDF comes from statistics unless it is nullptr
+    template <typename DocumentPredicate>
+    void FindAllDocuments(QueryContext& context, DocumentPredicate document_predicate, const CollectionStatistics* statistics = nullptr) const;
+
+    // Block-Max WAND over posting cursors, returns the top_count best documents already ordered
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsWand(const Query& query, DocumentBitmap& candidates, DocumentPredicate document_predicate, size_t top_count) const;
+    // Runs WAND over one segment, top_documents is a heap of at most top_count documents shared by the segments.
+    // query_terms holds the ids and IDFs of the plus words in query order.
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    void FindTopDocumentsWand(const IndexSegment& segment, const std::vector<std::pair<uint32_t, double>>& query_terms, const DocumentBitmap& candidates,
+        DocumentPredicate document_predicate, size_t top_count, std::vector<Document>& top_documents) const;
 };
 
 template <typename StringCollection>
@@ -145,51 +388,58 @@ SearchServer::SearchServer(const StringCollection& stop_words)
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-            return lhs.rating > rhs.rating;
-        }
-        else {
-            return lhs.relevance > rhs.relevance;
-        }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    return FindTopDocuments(GetQueryContext(), raw_query, document_predicate, top_count);
+}
 
-    return matched_documents;
+template <typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryContext& context, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    ParseQuery(raw_query, context.words_, context.query_);
+    SelectAllDocuments(context.candidates_);
+    FindAllDocuments(context, document_predicate);
+    SelectTopDocuments(context.documents_, top_count);
+    return context.documents_;
 }
 
 
 template <typename DocumentPredicate, typename Policy>
-std::vector<Document> SearchServer::FindTopDocuments(Policy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+std::vector<Document> SearchServer::FindTopDocuments(Policy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    if constexpr (std::is_same_v<std::decay_t<Policy>, std::execution::sequenced_policy>) {
+        return FindTopDocuments(raw_query, document_predicate, top_count);
+    }
     const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+    // The calling thread may pick up other queries while it waits, so the bitmap is its own
+    DocumentBitmap candidates;
+    SelectAllDocuments(candidates);
+    auto matched_documents = FindAllDocuments(policy, query, candidates, document_predicate);
+    SelectTopDocuments(matched_documents, top_count);
+    return matched_documents;
+}
 
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-            return lhs.rating > rhs.rating;
-        }
-        else {
-            return lhs.relevance > rhs.relevance;
-        }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+template <typename Policy>
+std::vector<Document> SearchServer::FindTopDocuments(Policy&& policy, std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    if constexpr (std::is_same_v<std::decay_t<Policy>, std::execution::sequenced_policy>) {
+        return FindTopDocuments(raw_query, status, top_count);
     }
-
+    const auto query = ParseQuery(raw_query);
+    DocumentBitmap candidates;
+    SelectStatusDocuments(status, candidates);
+    auto matched_documents = FindAllDocuments(policy, query, candidates, AcceptAll());
+    SelectTopDocuments(matched_documents, top_count);
     return matched_documents;
 }
 
 template <typename Policy>
-std::vector<Document> SearchServer::FindTopDocuments(Policy&& policy, std::string_view raw_query, DocumentStatus status) const {
-    return SearchServer::FindTopDocuments(policy, raw_query, [status](int id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-        });
+std::vector<Document> SearchServer::FindTopDocuments(Policy&& policy, std::string_view raw_query, const DocumentFilter& filter, size_t top_count) const {
+    if constexpr (std::is_same_v<std::decay_t<Policy>, std::execution::sequenced_policy>) {
+        return FindTopDocuments(raw_query, filter, top_count);
+    }
+    const auto query = ParseQuery(raw_query);
+    DocumentBitmap candidates;
+    SelectFilterDocuments(filter, candidates);
+    auto matched_documents = FindAllDocuments(policy, query, candidates, AcceptAll());
+    SelectTopDocuments(matched_documents, top_count);
+    return matched_documents;
 }
 
 template <typename Policy>
@@ -198,85 +448,343 @@ std::vector<Document> SearchServer::FindTopDocuments(Policy&& policy, std::strin
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_id_freqs_.count(std::string(word)) == 0) {
-            continue;
-        }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string(word));
-        for (const auto& [document_id, term_freq] : word_to_id_freqs_.at(std::string(word))) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
-            }
-        }
+std::vector<Document> SearchServer::FindTopDocuments(SearchMode mode, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    if (mode == SearchMode::EXHAUSTIVE) {
+        return FindTopDocuments(raw_query, document_predicate, top_count);
     }
+    QueryContext& context = GetQueryContext();
+    ParseQuery(raw_query, context.words_, context.query_);
+    SelectAllDocuments(context.candidates_);
+    return FindTopDocumentsWand(context.query_, context.candidates_, document_predicate, top_count);
+}
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_id_freqs_.count(std::string(word)) == 0) {
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsInCollection(const CollectionStatistics& statistics, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    QueryContext& context = GetQueryContext();
+    ParseQuery(raw_query, context.words_, context.query_);
+    SelectAllDocuments(context.candidates_);
+    FindAllDocuments(context, document_predicate, &statistics);
+    SelectTopDocuments(context.documents_, top_count);
+    return context.documents_;
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindAllDocuments(QueryContext& context, DocumentPredicate document_predicate, const CollectionStatistics* statistics) const {
+    DocumentBitmap& candidates = context.candidates_;
+    ExcludeMinusWords(context.query_, candidates);
+    ScoreAccumulator& document_to_relevance = context.scores_;
+    document_to_relevance.Reset(ordinal_to_id_.size());
+    for (std::string_view word : context.query_.plus_words) {
+        const uint32_t term_id = FindTermId(word);
+        if (term_id == NO_TERM) {
             continue;
         }
-        for (const auto& [document_id, _] : word_to_id_freqs_.at(std::string(word))) {
-            document_to_relevance.erase(document_id);
-        }
+        const double inverse_document_freq = statistics == nullptr
+            ? ComputeWordInverseDocumentFreq(term_id) : statistics->ComputeInverseDocumentFreq(word);
+        ForEachPostings(term_id, [&](const Postings& postings) {
+            postings.ForEach([&](int ordinal, double term_freq) {
+                if (candidates.Test(ordinal) && document_predicate(ordinal_to_id_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+                    document_to_relevance.Add(ordinal, term_freq * inverse_document_freq);
+                }
+                });
+            });
     }
 
-    std::vector<Document> matched_documents;
-    for (const auto& [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+    // Ordinal order keeps ties in the order of addition, as the ordered map did
+    document_to_relevance.SortTouched();
+    std::vector<Document>& matched_documents = context.documents_;
+    matched_documents.clear();
+    for (int ordinal : document_to_relevance.GetTouched()) {
+        matched_documents.push_back({ ordinal_to_id_[ordinal], document_to_relevance.Get(ordinal), ratings_[ordinal] });
     }
-    return matched_documents;
 }
 
 template <typename DocumentPredicate, typename Policy>
-std::vector<Document> SearchServer::FindAllDocuments(Policy&& policy, const SearchServer::Query& query, DocumentPredicate document_predicate) const {
+std::vector<Document> SearchServer::FindAllDocuments(Policy&& policy, const SearchServer::Query& query, DocumentBitmap& candidates, DocumentPredicate document_predicate) const {
+    ExcludeMinusWords(query, candidates);
     ConcurrentMap<int, double> document_to_relevance(100);
 
     std::for_each(policy, query.plus_words.begin(), query.plus_words.end(), [&](std::string_view word) {
-        if (word_to_id_freqs_.count(std::string(word)) > 0) {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string(word));
-            for (const auto [document_id, term_freq] : word_to_id_freqs_.at(std::string(word))) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                }
-            }
+        const uint32_t term_id = FindTermId(word);
+        if (term_id != NO_TERM) {
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id);
+            ForEachPostings(term_id, [&](const Postings& postings) {
+                postings.ForEach([&](int ordinal, double term_freq) {
+                    if (candidates.Test(ordinal) && document_predicate(ordinal_to_id_[ordinal], statuses_[ordinal], ratings_[ordinal])) {
+                        document_to_relevance[ordinal].ref_to_value += term_freq * inverse_document_freq;
+                    }
+                    });
+                });
         }
         });
 
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(), [&](std::string_view word) {
-        if (word_to_id_freqs_.count(std::string(word)) > 0) {
-            for (const auto [document_id, _] : word_to_id_freqs_.at(std::string(word))) {
-                document_to_relevance.BuildOrdinaryMap().erase(document_id);
+    std::vector<Document> matched_documents;
+    for (const auto& [ordinal, relevance] : document_to_relevance.BuildOrdinaryMap()) {
+        matched_documents.push_back({ ordinal_to_id_[ordinal], relevance, ratings_[ordinal] });
+    }
+
+    return matched_documents;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWand(const Query& query, DocumentBitmap& candidates, DocumentPredicate document_predicate, size_t top_count) const {
+    std::vector<Document> top_documents;
+    if (top_count == 0) {
+        return top_documents;
+    }
+
+    std::vector<std::pair<uint32_t, double>> terms;
+    for (std::string_view word : query.plus_words) {
+        const uint32_t term_id = FindTermId(word);
+        if (term_id != NO_TERM) {
+            terms.emplace_back(term_id, ComputeWordInverseDocumentFreq(term_id));
+        }
+    }
+    ExcludeMinusWords(query, candidates);
+
+    // Segments hold disjoint ordinal ranges, so the top of the earlier ones prunes the later ones
+    for (const auto& segment : segments_) {
+        FindTopDocumentsWand(*segment, terms, candidates, document_predicate, top_count, top_documents);
+    }
+    FindTopDocumentsWand(mutable_segment_, terms, candidates, document_predicate, top_count, top_documents);
+
+    SelectTopDocuments(top_documents, top_count);
+    return top_documents;
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindTopDocumentsWand(const IndexSegment& segment, const std::vector<std::pair<uint32_t, double>>& query_terms, const DocumentBitmap& candidates,
+    DocumentPredicate document_predicate, size_t top_count, std::vector<Document>& top_documents) const {
+    struct TermCursor {
+        Postings::Cursor cursor;
+        double inverse_document_freq;
+        double max_score;
+        // Current document of the cursor or INT_MAX once it is exhausted
+        int ordinal = INT_MAX;
+        // Stays valid while the pivot does not pass its last document
+        PostingBlockBound block = { -1, 0.0 };
+
+        void Sync() {
+            ordinal = cursor.AtEnd() ? INT_MAX : cursor.GetDocumentId();
+        }
+    };
+
+    // Kept in plus_words order, so a document score is summed exactly as in FindAllDocuments
+    std::vector<TermCursor> terms;
+    for (const auto& [term_id, inverse_document_freq] : query_terms) {
+        if (const Postings* postings = segment.Find(term_id)) {
+            terms.push_back({ Postings::Cursor(*postings), inverse_document_freq, postings->GetMaxTermFreq() * inverse_document_freq });
+            terms.back().Sync();
+        }
+    }
+
+    // Heap by is_better keeps the worst of the current top in front
+    const auto is_better = [](const Document& lhs, const Document& rhs) {
+        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+            return lhs.rating > rhs.rating;
+        }
+        return lhs.relevance > rhs.relevance;
+    };
+    // A document can only enter a full top if it scores at least the worst relevance minus EPSILON
+    double threshold = -std::numeric_limits<double>::infinity();
+    if (top_documents.size() == top_count) {
+        threshold = top_documents.front().relevance - EPSILON;
+    }
+
+    // Cursors by (document, position in the query). Moved cursors are always a prefix and are put
+    // back by insertion, which is cheap because they rarely travel far.
+    std::vector<size_t> order(terms.size());
+    std::iota(order.begin(), order.end(), 0);
+    const auto precedes = [&terms](size_t lhs, size_t rhs) {
+        return terms[lhs].ordinal < terms[rhs].ordinal || (terms[lhs].ordinal == terms[rhs].ordinal && lhs < rhs);
+    };
+    const auto restore_order = [&](size_t moved_count) {
+        for (size_t i = moved_count; i-- > 0;) {
+            const size_t term = order[i];
+            size_t j = i;
+            for (; j + 1 < order.size() && precedes(order[j + 1], term); ++j) {
+                order[j] = order[j + 1];
             }
+            order[j] = term;
+        }
+    };
+    restore_order(order.size());
+
+    while (true) {
+        // Pivot is the first document whose accumulated upper bound reaches the threshold
+        size_t pivot = 0;
+        double upper_bound = 0.0;
+        for (; pivot < order.size() && terms[order[pivot]].ordinal != INT_MAX; ++pivot) {
+            upper_bound += terms[order[pivot]].max_score;
+            if (upper_bound >= threshold) {
+                break;
+            }
+        }
+        if (pivot == order.size() || terms[order[pivot]].ordinal == INT_MAX) {
+            break;
+        }
+        const int pivot_ordinal = terms[order[pivot]].ordinal;
+        while (pivot + 1 < order.size() && terms[order[pivot + 1]].ordinal == pivot_ordinal) {
+            ++pivot;
         }
-        });
 
-    std::vector<Document> matched_documents;
-    for (const auto& [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+        // Sharper bound from the blocks the pivot falls into
+        double block_upper_bound = 0.0;
+        int next_ordinal = pivot + 1 < order.size() ? terms[order[pivot + 1]].ordinal : INT_MAX;
+        for (size_t i = 0; i <= pivot; ++i) {
+            TermCursor& term = terms[order[i]];
+            if (term.block.last_document_id < pivot_ordinal) {
+                term.block = term.cursor.GetBlockBound(pivot_ordinal);
+            }
+            block_upper_bound += term.block.max_term_freq * term.inverse_document_freq;
+            if (term.block.last_document_id < next_ordinal - 1) {
+                next_ordinal = term.block.last_document_id + 1;
+            }
+        }
+        if (block_upper_bound < threshold) {
+            for (size_t i = 0; i <= pivot; ++i) {
+                terms[order[i]].cursor.Advance(next_ordinal);
+                terms[order[i]].Sync();
+            }
+            restore_order(pivot + 1);
+            continue;
+        }
+
+        if (terms[order[0]].ordinal != pivot_ordinal) {
+            for (size_t i = 0; i < pivot && terms[order[i]].ordinal != pivot_ordinal; ++i) {
+                terms[order[i]].cursor.Advance(pivot_ordinal);
+                terms[order[i]].Sync();
+            }
+            restore_order(pivot);
+            continue;
+        }
+
+        if (candidates.Test(pivot_ordinal) && document_predicate(ordinal_to_id_[pivot_ordinal], statuses_[pivot_ordinal], ratings_[pivot_ordinal])) {
+            // Cursors on the pivot are ordered by their position in the query
+            double relevance = 0.0;
+            for (size_t i = 0; i <= pivot; ++i) {
+                const TermCursor& term = terms[order[i]];
+                relevance += term.cursor.GetTermFreq() * term.inverse_document_freq;
+            }
+            const Document document{ ordinal_to_id_[pivot_ordinal], relevance, ratings_[pivot_ordinal] };
+            if (top_documents.size() < top_count) {
+                top_documents.push_back(document);
+                std::push_heap(top_documents.begin(), top_documents.end(), is_better);
+            }
+            else if (is_better(document, top_documents.front())) {
+                std::pop_heap(top_documents.begin(), top_documents.end(), is_better);
+                top_documents.back() = document;
+                std::push_heap(top_documents.begin(), top_documents.end(), is_better);
+            }
+            if (top_documents.size() == top_count) {
+                threshold = top_documents.front().relevance - EPSILON;
+            }
+        }
+        for (size_t i = 0; i <= pivot; ++i) {
+            terms[order[i]].cursor.Next();
+            terms[order[i]].Sync();
+        }
+        restore_order(pivot + 1);
     }
+}
 
-    return matched_documents;
+template<typename Policy>
+void SearchServer::AddDocuments(Policy&& policy, const std::vector<DocumentInput>& documents) {
+    CheckNewDocumentIds(documents);
+    if (documents.empty()) {
+        return;
+    }
+
+    size_t slice_count = 1;
+    if constexpr (!std::is_same_v<std::decay_t<Policy>, std::execution::sequenced_policy>) {
+        slice_count = std::min<size_t>(documents.size(), std::max(1u, std::thread::hardware_concurrency()));
+    }
+    std::vector<PartialIndex> partials(slice_count);
+    for (size_t i = 0; i < slice_count; ++i) {
+        partials[i].first_document = documents.size() * i / slice_count;
+        partials[i].document_count = documents.size() * (i + 1) / slice_count - partials[i].first_document;
+    }
+    std::for_each(policy, partials.begin(), partials.end(), [this, &documents](PartialIndex& partial) {
+        BuildPartialIndex(documents, partial);
+        });
+    InternPartialTerms(partials);
+
+    const int first_ordinal = static_cast<int>(ordinal_to_id_.size());
+    std::for_each(policy, partials.begin(), partials.end(), [first_ordinal, slice_count](PartialIndex& partial) {
+        SortPartialIndex(partial, first_ordinal + static_cast<int>(partial.first_document), slice_count);
+        });
+    // A term belongs to one shard, so every posting list and its document frequency is written by one thread
+    std::vector<size_t> shards(slice_count);
+    std::iota(shards.begin(), shards.end(), 0);
+    std::for_each(policy, shards.begin(), shards.end(), [this, &partials](size_t shard) {
+        AppendShardPostings(partials, shard);
+        });
+    AppendPartialDocuments(documents, partials);
+    UpdateSegments();
 }
 
 template<typename Policy>
 void SearchServer::RemoveDocument(Policy&& policy, int document_id) {
-    const auto& words_freqs = GetWordFrequencies(document_id);
-    if (!words_freqs.empty()) {
-        std::vector<std::string> words;
-        words.reserve(words_freqs.size());
-        std::for_each(policy, words_freqs.begin(), words_freqs.end(), [&words](auto& wf) {
-            words.push_back(std::string(wf.first));
-            });
+    if (TombstoneDocument(document_id) && NeedsCompaction()) {
+        Compact(policy);
+    }
+}
 
-        std::for_each(policy, words.begin(), words.end(), [this, document_id](const auto& word) {
-            return word_to_id_freqs_[word].erase(document_id);
-            });
+template<typename Policy>
+void SearchServer::RemoveDocuments(Policy&& policy, const std::vector<int>& document_ids) {
+    for (int document_id : document_ids) {
+        TombstoneDocument(document_id);
+    }
+    if (NeedsCompaction()) {
+        Compact(policy);
     }
+}
 
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
-    id_to_word_freqs_.erase(document_id);
+template<typename Policy>
+void SearchServer::Compact(Policy&& policy) {
+    if (tombstones_.empty()) {
+        return;
+    }
+    // A merge started before would bring back segments with the postings of these documents
+    WaitForMerges();
+    std::sort(tombstones_.begin(), tombstones_.end());
+    DocumentBitmap removed;
+    removed.Assign(ordinal_to_id_.size());
+    std::vector<uint32_t> term_ids;
+    for (int ordinal : tombstones_) {
+        removed.Set(ordinal);
+        if (ordinal >= mutable_segment_.GetFirstOrdinal()) {
+            const DocumentTerms terms = forward_index_.Get(ordinal);
+            term_ids.insert(term_ids.end(), terms.term_ids, terms.term_ids + terms.size);
+        }
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+
+    // Every call rewrites its own posting list once for the whole batch
+    std::for_each(policy, term_ids.begin(), term_ids.end(), [this, &removed](uint32_t term_id) {
+        if (Postings* postings = mutable_segment_.Find(term_id)) {
+            postings->Erase(removed);
+        }
+        });
+    // Frozen segments are replaced by rewritten copies, never changed
+    std::for_each(policy, segments_.begin(), segments_.end(), [this, &removed](std::shared_ptr<const IndexSegment>& segment) {
+        if (HasTombstones(*segment)) {
+            segment = std::make_shared<const IndexSegment>(IndexSegment::Merge({ segment.get() }, removed));
+        }
+        });
+    forward_index_.Erase(removed);
+    tombstones_.clear();
+}
+
+template <typename Function>
+void SearchServer::ForEachPostings(uint32_t term_id, Function function) const {
+    for (const auto& segment : segments_) {
+        if (const Postings* postings = segment->Find(term_id)) {
+            function(*postings);
+        }
+    }
+    if (const Postings* postings = mutable_segment_.Find(term_id)) {
+        function(*postings);
+    }
 }
\ No newline at end of file
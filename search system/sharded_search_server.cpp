@@ -0,0 +1,116 @@
+#include <exception>
+
+#include "sharded_search_server.h"
+
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Negative ID"s);
+    }
+    shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<DocumentInput>& documents) {
+    std::vector<std::vector<DocumentInput>> batches(shards_.size());
+    for (const DocumentInput& document : documents) {
+        if (document.id < 0) {
+            throw std::invalid_argument("Negative ID"s);
+        }
+        batches[GetShardIndex(document.id)].push_back(document);
+    }
+
+    // Exceptions must not leave a parallel algorithm, they are rethrown after the shards that
+    // succeeded have removed their part again
+    std::vector<std::exception_ptr> errors(shards_.size());
+    std::vector<size_t> indexes(shards_.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [this, &batches, &errors](size_t index) {
+        try {
+            shards_[index].AddDocuments(batches[index]);
+        }
+        catch (...) {
+            errors[index] = std::current_exception();
+        }
+        });
+
+    const auto error = std::find_if(errors.begin(), errors.end(), [](const std::exception_ptr& e) {
+        return e != nullptr;
+        });
+    if (error == errors.end()) {
+        return;
+    }
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        if (errors[index] == nullptr) {
+            std::vector<int> document_ids;
+            for (const DocumentInput& document : batches[index]) {
+                document_ids.push_back(document.id);
+            }
+            shards_[index].RemoveDocuments(document_ids);
+        }
+    }
+    std::rethrow_exception(*error);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id >= 0) {
+        shards_[GetShardIndex(document_id)].RemoveDocument(document_id);
+    }
+}
+
+void ShardedSearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    std::vector<std::vector<int>> batches(shards_.size());
+    for (int document_id : document_ids) {
+        if (document_id >= 0) {
+            batches[GetShardIndex(document_id)].push_back(document_id);
+        }
+    }
+    for (size_t index = 0; index < shards_.size(); ++index) {
+        shards_[index].RemoveDocuments(batches[index]);
+    }
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_count) const {
+    return FindTopDocuments(raw_query, DocumentFilter::StatusIn({ status }), top_count);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter, size_t top_count) const {
+    return FindTopDocumentsOnShards(raw_query, top_count, [&](const SearchServer& shard, const CollectionStatistics& statistics) {
+        return shard.FindTopDocumentsInCollection(statistics, raw_query, filter, top_count);
+        });
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    if (document_id < 0) {
+        throw std::out_of_range("Negative ID"s);
+    }
+    return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+WordFrequencies ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    if (document_id < 0) {
+        return {};
+    }
+    return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t index) const {
+    return shards_.at(index);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    // Ids are often sequential, mixing the bits keeps ranges of them spread over the shards
+    uint64_t hash = static_cast<uint64_t>(document_id) * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>((hash >> 32) % shards_.size());
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "search_server.h"
+
+
+// Documents hash-partitioned by id across independent SearchServer shards. A query first sums the
+// document frequencies of its words over the shards, then runs on every shard in parallel with the
+// IDF of the whole collection and merges the per-shard tops, so the ranking matches a single server.
+class ShardedSearchServer {
+public:
+    template <typename StopWords>
+    ShardedSearchServer(size_t shard_count, const StopWords& stop_words);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // Every shard adds its part of the batch on its own thread
+    void AddDocuments(const std::vector<DocumentInput>& documents);
+    void RemoveDocument(int document_id);
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const DocumentFilter& filter, size_t top_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+    WordFrequencies GetWordFrequencies(int document_id) const;
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+    const SearchServer& GetShard(size_t index) const;
+
+private:
+    std::vector<SearchServer> shards_;
+
+    size_t GetShardIndex(int document_id) const;
+
+    // Calls search(shard, statistics) on every shard in parallel and merges the results
+    template <typename Search>
+    std::vector<Document> FindTopDocumentsOnShards(std::string_view raw_query, size_t top_count, Search search) const;
+};
+
+template <typename StopWords>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StopWords& stop_words) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("No shards"s);
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_count) const {
+    return FindTopDocumentsOnShards(raw_query, top_count, [&](const SearchServer& shard, const CollectionStatistics& statistics) {
+        return shard.FindTopDocumentsInCollection(statistics, raw_query, document_predicate, top_count);
+        });
+}
+
+template <typename Search>
+std::vector<Document> ShardedSearchServer::FindTopDocumentsOnShards(std::string_view raw_query, size_t top_count, Search search) const {
+    // Also validates the query, so no shard throws inside the parallel loop
+    CollectionStatistics statistics;
+    for (const SearchServer& shard : shards_) {
+        statistics += shard.GetQueryStatistics(raw_query);
+    }
+
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    std::vector<size_t> indexes(shards_.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](size_t index) {
+        shard_documents[index] = search(shards_[index], statistics);
+        });
+
+    std::vector<Document> documents;
+    for (const std::vector<Document>& part : shard_documents) {
+        documents.insert(documents.end(), part.begin(), part.end());
+    }
+    SearchServer::SelectTopDocuments(documents, top_count);
+    return documents;
+}
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "snapshot_file.h"
+#include "file_sync.h"
+
+using namespace std::string_literals;
+
+
+namespace {
+
+    size_t AlignSection(size_t offset) {
+        const size_t alignment = SnapshotFormat::SECTION_ALIGNMENT;
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+}
+
+
+uint64_t SnapshotFormat::ComputeChecksum(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+
+void SnapshotWriter::Write(const std::string& path, uint32_t version) const {
+    std::vector<SnapshotFormat::Section> table;
+    size_t offset = AlignSection(sizeof(SnapshotFormat::Header) + sections_.size() * sizeof(SnapshotFormat::Section));
+    for (const PendingSection& section : sections_) {
+        table.push_back({ section.id, section.element_size, offset, section.size, SnapshotFormat::ComputeChecksum(section.data, section.size) });
+        offset = AlignSection(offset + section.size);
+    }
+
+    SnapshotFormat::Header header = {};
+    std::memcpy(header.magic, SnapshotFormat::MAGIC, sizeof(header.magic));
+    header.version = version;
+    header.section_count = static_cast<uint32_t>(table.size());
+    header.file_size = offset;
+    header.table_checksum = SnapshotFormat::ComputeChecksum(table.data(), table.size() * sizeof(SnapshotFormat::Section));
+
+    const std::string temporary_path = path + ".tmp"s;
+    std::FILE* output = std::fopen(temporary_path.c_str(), "wb");
+    if (output == nullptr) {
+        throw std::runtime_error("Cannot write snapshot "s + path);
+    }
+    const auto write = [output](const void* data, size_t size) {
+        return size == 0 || std::fwrite(data, 1, size, output) == size;
+    };
+    const char padding[SnapshotFormat::SECTION_ALIGNMENT] = {};
+    bool written = write(&header, sizeof(header)) && write(table.data(), table.size() * sizeof(SnapshotFormat::Section));
+    size_t position = sizeof(header) + table.size() * sizeof(SnapshotFormat::Section);
+    for (size_t i = 0; written && i < sections_.size(); ++i) {
+        written = write(padding, table[i].offset - position) && write(sections_[i].data, sections_[i].size);
+        position = table[i].offset + sections_[i].size;
+    }
+    // The contents reach the disk before the rename makes them the snapshot, otherwise a crash
+    // of the machine could leave the new name on an empty file
+    written = written && write(padding, offset - position) && SyncFile(output, temporary_path);
+    written = std::fclose(output) == 0 && written;
+    std::error_code error;
+    if (!written) {
+        std::filesystem::remove(temporary_path, error);
+        throw std::runtime_error("Cannot write snapshot "s + path);
+    }
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::filesystem::remove(temporary_path, error);
+        throw std::runtime_error("Cannot write snapshot "s + path);
+    }
+    // The rename itself is only durable once the directory is synced
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (!SyncDirectory(directory.empty() ? "."s : directory.string())) {
+        throw std::runtime_error("Cannot write snapshot "s + path);
+    }
+}
+
+
+SnapshotReader::SnapshotReader(const std::string& path, uint32_t version, bool check_sections) {
+    Open(path);
+    try {
+        Check(version, check_sections);
+    }
+    catch (...) {
+#ifndef _WIN32
+        if (mapped_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+        throw;
+    }
+}
+
+SnapshotReader::~SnapshotReader() {
+#ifndef _WIN32
+    if (mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+}
+
+void SnapshotReader::Open(const std::string& path) {
+#ifndef _WIN32
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error("Cannot open snapshot "s + path);
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0) {
+        close(file);
+        throw std::runtime_error("Cannot open snapshot "s + path);
+    }
+    size_ = static_cast<size_t>(status.st_size);
+    if (size_ > 0) {
+        // Read-only shared pages: processes loading the same snapshot share the page cache
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file, 0);
+        if (data != MAP_FAILED) {
+            data_ = static_cast<const char*>(data);
+            mapped_ = true;
+        }
+    }
+    close(file);
+    if (mapped_ || size_ == 0) {
+        return;
+    }
+#endif
+    std::ifstream input(path, std::ios::binary | std::ios::ate);
+    if (!input) {
+        throw std::runtime_error("Cannot open snapshot "s + path);
+    }
+    size_ = static_cast<size_t>(input.tellg());
+    // Words, not bytes, so that the sections are aligned for their elements
+    buffer_.resize((size_ + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    input.seekg(0);
+    input.read(reinterpret_cast<char*>(buffer_.data()), size_);
+    if (!input) {
+        throw std::runtime_error("Cannot read snapshot "s + path);
+    }
+    data_ = reinterpret_cast<const char*>(buffer_.data());
+}
+
+void SnapshotReader::Check(uint32_t version, bool check_sections) {
+    SnapshotFormat::Header header;
+    if (size_ < sizeof(header)) {
+        throw std::runtime_error("Snapshot is damaged"s);
+    }
+    std::memcpy(&header, data_, sizeof(header));
+    if (std::memcmp(header.magic, SnapshotFormat::MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a snapshot file"s);
+    }
+    if (header.version != version) {
+        throw std::runtime_error("Unsupported snapshot version "s + std::to_string(header.version));
+    }
+    const size_t table_size = static_cast<size_t>(header.section_count) * sizeof(SnapshotFormat::Section);
+    if (header.file_size != size_ || (size_ - sizeof(header)) < table_size) {
+        throw std::runtime_error("Snapshot is damaged"s);
+    }
+    if (SnapshotFormat::ComputeChecksum(data_ + sizeof(header), table_size) != header.table_checksum) {
+        throw std::runtime_error("Snapshot is damaged"s);
+    }
+
+    sections_.resize(header.section_count);
+    std::memcpy(sections_.data(), data_ + sizeof(header), table_size);
+    for (const SnapshotFormat::Section& section : sections_) {
+        if (section.element_size == 0 || section.offset % SnapshotFormat::SECTION_ALIGNMENT != 0 || section.offset > size_
+            || section.size > size_ - section.offset || section.size % section.element_size != 0
+            || (check_sections && SnapshotFormat::ComputeChecksum(data_ + section.offset, section.size) != section.checksum)) {
+            throw std::runtime_error("Snapshot is damaged"s);
+        }
+    }
+}
+
+const SnapshotFormat::Section& SnapshotReader::FindSection(uint32_t id, size_t element_size) const {
+    const auto it = std::find_if(sections_.begin(), sections_.end(), [id](const SnapshotFormat::Section& section) {
+        return section.id == id;
+    });
+    if (it == sections_.end() || it->element_size != element_size) {
+        throw std::runtime_error("Snapshot has no section "s + std::to_string(id) + " of this build"s);
+    }
+    return *it;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// Array stored in a snapshot section, valid while its SnapshotReader lives
+template <typename T>
+struct SnapshotArray {
+    const T* data = nullptr;
+    size_t size = 0;
+
+    const T& operator[](size_t index) const {
+        return data[index];
+    }
+    const T* begin() const {
+        return data;
+    }
+    const T* end() const {
+        return data + size;
+    }
+};
+
+// Layout shared by SnapshotWriter and SnapshotReader. The file starts with a header and a table
+// of sections, then every section holds one flat array of fixed-size elements in the byte order
+// of the machine. Sections start at multiples of SECTION_ALIGNMENT, so once the file is mapped
+// to memory the arrays are used where they lie. The table and each section carry an FNV-1a checksum.
+// Checking the section checksums reads the whole file, so readers only do it when asked.
+struct SnapshotFormat {
+    static constexpr size_t SECTION_ALIGNMENT = 64;
+    static constexpr char MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P' };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t section_count;
+        uint64_t file_size;
+        uint64_t table_checksum;
+    };
+
+    struct Section {
+        uint32_t id;
+        uint32_t element_size;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;
+    };
+
+    static uint64_t ComputeChecksum(const void* data, size_t size);
+};
+
+// Collects sections and writes them to a file at once. Only pointers to the arrays are kept,
+// so they must not change until Write returns.
+class SnapshotWriter {
+public:
+    // Any contiguous container with data() and size(), such as std::vector
+    template <typename Container>
+    void AddSection(uint32_t id, const Container& values);
+
+    // Writes and syncs a temporary file next to path, renames it and syncs the directory, so a failed
+    // write keeps the old snapshot and once Write returns the new one survives a crash of the machine.
+    // Throws std::runtime_error if the file cannot be written.
+    void Write(const std::string& path, uint32_t version) const;
+
+private:
+    struct PendingSection {
+        uint32_t id;
+        uint32_t element_size;
+        const char* data;
+        size_t size;
+    };
+
+    std::vector<PendingSection> sections_;
+};
+
+// Maps a snapshot file to memory read-only and checks the header and the table of sections before
+// any section is handed out. Where mapping is not available the file is read into a buffer instead.
+class SnapshotReader {
+public:
+    // With check_sections the checksum of every section is verified too, which reads every page.
+    // Throws std::runtime_error if the file cannot be opened, has another version or a checksum does not match
+    SnapshotReader(const std::string& path, uint32_t version, bool check_sections = false);
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    // Throws std::runtime_error if there is no such section or its elements have another size
+    template <typename T>
+    SnapshotArray<T> GetSection(uint32_t id) const;
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::vector<uint64_t> buffer_;
+    std::vector<SnapshotFormat::Section> sections_;
+
+    void Open(const std::string& path);
+    void Check(uint32_t version, bool check_sections);
+    const SnapshotFormat::Section& FindSection(uint32_t id, size_t element_size) const;
+};
+
+template <typename Container>
+void SnapshotWriter::AddSection(uint32_t id, const Container& values) {
+    using T = typename Container::value_type;
+    sections_.push_back({ id, static_cast<uint32_t>(sizeof(T)), reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T) });
+}
+
+template <typename T>
+SnapshotArray<T> SnapshotReader::GetSection(uint32_t id) const {
+    const SnapshotFormat::Section& section = FindSection(id, sizeof(T));
+    return { reinterpret_cast<const T*>(data_ + section.offset), static_cast<size_t>(section.size / sizeof(T)) };
+}
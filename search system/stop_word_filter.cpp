@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <utility>
+
+#include "stop_word_filter.h"
+
+
+namespace {
+
+    // Displacements tried for one bucket before the whole table is built again with the next seed
+    const uint32_t MAX_DISPLACEMENT = 1u << 16;
+    // Seeds tried for one table size before the table doubles
+    const uint64_t SEEDS_PER_SIZE = 8;
+
+    size_t RoundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result *= 2;
+        }
+        return result;
+    }
+
+}
+
+
+StopWordFilter::StopWordFilter(const StringSet& words)
+    : words_(words.begin(), words.end()) {
+    if (words_.empty()) {
+        return;
+    }
+    // Half of the slots stay free, so most buckets settle within a few displacements
+    size_t slot_count = RoundUpToPowerOfTwo(words_.size() * 2);
+    for (uint64_t seed = 1; !Build(seed, slot_count); ++seed) {
+        if (seed % SEEDS_PER_SIZE == 0) {
+            slot_count *= 2;
+        }
+    }
+}
+
+std::vector<std::string>::const_iterator StopWordFilter::begin() const {
+    return words_.begin();
+}
+
+std::vector<std::string>::const_iterator StopWordFilter::end() const {
+    return words_.end();
+}
+
+size_t StopWordFilter::size() const {
+    return words_.size();
+}
+
+bool StopWordFilter::Build(uint64_t seed, size_t slot_count) {
+    // About four words per bucket
+    const size_t bucket_count = RoundUpToPowerOfTwo((words_.size() + 3) / 4);
+    std::vector<uint64_t> hashes(words_.size());
+    std::vector<std::vector<uint32_t>> buckets(bucket_count);
+    for (uint32_t index = 0; index < words_.size(); ++index) {
+        hashes[index] = Hash(words_[index], seed);
+        buckets[hashes[index] & (bucket_count - 1)].push_back(index);
+    }
+    // Larger buckets are placed first, while the table is still empty
+    std::vector<uint32_t> order(bucket_count);
+    for (uint32_t bucket = 0; bucket < bucket_count; ++bucket) {
+        order[bucket] = bucket;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t lhs, uint32_t rhs) {
+        return buckets[lhs].size() > buckets[rhs].size();
+    });
+
+    std::vector<uint32_t> displacements(bucket_count, 0);
+    std::vector<uint32_t> slots(slot_count, NO_WORD);
+    std::vector<size_t> bucket_slots;
+    for (uint32_t bucket : order) {
+        if (buckets[bucket].empty()) {
+            break;
+        }
+        uint32_t displacement = 0;
+        for (; displacement < MAX_DISPLACEMENT; ++displacement) {
+            bucket_slots.clear();
+            for (uint32_t index : buckets[bucket]) {
+                const size_t slot = Displace(hashes[index], displacement) & (slot_count - 1);
+                if (slots[slot] != NO_WORD || std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+                    break;
+                }
+                bucket_slots.push_back(slot);
+            }
+            if (bucket_slots.size() == buckets[bucket].size()) {
+                break;
+            }
+        }
+        if (displacement == MAX_DISPLACEMENT) {
+            return false;
+        }
+        displacements[bucket] = displacement;
+        for (size_t i = 0; i < bucket_slots.size(); ++i) {
+            slots[bucket_slots[i]] = buckets[bucket][i];
+        }
+    }
+
+    seed_ = seed;
+    displacements_ = std::move(displacements);
+    slots_ = std::move(slots);
+    bucket_mask_ = bucket_count - 1;
+    slot_mask_ = slot_count - 1;
+    return true;
+}
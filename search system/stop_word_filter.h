@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_processing.h"
+
+
+// Set of stop words behind a perfect hash built at construction by hash and displace: words are
+// split into buckets by a seeded hash, and every bucket gets a displacement that sends each of its
+// words to a slot of its own. A lookup is one hash of the word, two table reads and one comparison,
+// with no allocation.
+class StopWordFilter {
+public:
+    StopWordFilter() = default;
+    explicit StopWordFilter(const StringSet& words);
+
+    bool Contains(std::string_view word) const {
+        if (words_.empty()) {
+            return false;
+        }
+        const uint64_t hash = Hash(word, seed_);
+        const uint32_t index = slots_[Displace(hash, displacements_[hash & bucket_mask_]) & slot_mask_];
+        return index != NO_WORD && words_[index] == word;
+    }
+
+    // Words in ascending order
+    std::vector<std::string>::const_iterator begin() const;
+    std::vector<std::string>::const_iterator end() const;
+    size_t size() const;
+
+private:
+    static constexpr uint32_t NO_WORD = UINT32_MAX;
+
+    std::vector<std::string> words_;
+    uint64_t seed_ = 0;
+    // Displacement of every bucket and the word of every slot, both sizes are powers of two
+    std::vector<uint32_t> displacements_;
+    std::vector<uint32_t> slots_;
+    uint64_t bucket_mask_ = 0;
+    uint64_t slot_mask_ = 0;
+
+    // FNV-1a with the seed mixed into the offset basis
+    static uint64_t Hash(std::string_view word, uint64_t seed) {
+        uint64_t hash = 14695981039346656037ull ^ seed;
+        for (char c : word) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Slot bits of the hash moved by the displacement of its bucket, spread by a splitmix finalizer
+    static uint64_t Displace(uint64_t hash, uint32_t displacement) {
+        uint64_t x = hash ^ (displacement * 0x9E3779B97F4A7C15ull);
+        x ^= x >> 31;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 29;
+        return x;
+    }
+
+    // False if some bucket finds no displacement with this seed and table size
+    bool Build(uint64_t seed, size_t slot_count);
+};
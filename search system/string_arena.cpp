@@ -0,0 +1,58 @@
+#include <cstring>
+#include <utility>
+
+#include "string_arena.h"
+
+
+StringArena::StringArena(StringArena&& other) noexcept
+    : chunks_(std::move(other.chunks_))
+    , free_(std::exchange(other.free_, nullptr))
+    , free_size_(std::exchange(other.free_size_, 0))
+    , stored_size_(std::exchange(other.stored_size_, 0))
+    , allocated_size_(std::exchange(other.allocated_size_, 0)) {
+    other.chunks_.clear();
+}
+
+StringArena& StringArena::operator=(StringArena&& other) noexcept {
+    if (this != &other) {
+        chunks_ = std::move(other.chunks_);
+        other.chunks_.clear();
+        free_ = std::exchange(other.free_, nullptr);
+        free_size_ = std::exchange(other.free_size_, 0);
+        stored_size_ = std::exchange(other.stored_size_, 0);
+        allocated_size_ = std::exchange(other.allocated_size_, 0);
+    }
+    return *this;
+}
+
+std::string_view StringArena::Store(std::string_view str) {
+    stored_size_ += str.size();
+    if (str.size() > CHUNK_SIZE / 2) {
+        // Long strings get their own chunk and leave the free bytes of the current one for later
+        chunks_.push_back(std::make_unique<char[]>(str.size()));
+        allocated_size_ += str.size();
+        std::memcpy(chunks_.back().get(), str.data(), str.size());
+        return { chunks_.back().get(), str.size() };
+    }
+    if (str.size() > free_size_) {
+        chunks_.push_back(std::make_unique<char[]>(CHUNK_SIZE));
+        allocated_size_ += CHUNK_SIZE;
+        free_ = chunks_.back().get();
+        free_size_ = CHUNK_SIZE;
+    }
+    char* data = free_;
+    if (!str.empty()) {
+        std::memcpy(data, str.data(), str.size());
+    }
+    free_ += str.size();
+    free_size_ -= str.size();
+    return { data, str.size() };
+}
+
+size_t StringArena::GetStoredSize() const {
+    return stored_size_;
+}
+
+size_t StringArena::GetAllocatedSize() const {
+    return allocated_size_;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+
+// Append-only storage of string bytes in large chunks instead of one heap block per string.
+// Stored bytes never move, so views of them stay valid while the arena lives, moves included.
+// Copying is not allowed, since the copies of the views would still point into the original.
+class StringArena {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    StringArena() = default;
+    // The moved-from arena is empty
+    StringArena(StringArena&& other) noexcept;
+    StringArena& operator=(StringArena&& other) noexcept;
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    // Copies the bytes into the arena, a string longer than half a chunk gets a chunk of its own
+    std::string_view Store(std::string_view str);
+
+    // Bytes of the stored strings and bytes taken from the heap
+    size_t GetStoredSize() const;
+    size_t GetAllocatedSize() const;
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    // Free bytes at the end of the last chunk
+    char* free_ = nullptr;
+    size_t free_size_ = 0;
+    size_t stored_size_ = 0;
+    size_t allocated_size_ = 0;
+};
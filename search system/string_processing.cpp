@@ -1,5 +1,78 @@
+#include <cstdint>
+
 #include "string_processing.h"
 
+#if defined(__AVX2__)
+#define TOKENIZER_USE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TOKENIZER_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+    // Bit i stands for byte i of a block
+    struct BlockMasks {
+        uint32_t spaces;
+        uint32_t controls;
+    };
+
+    BlockMasks ScanBytes(const char* data, size_t size) {
+        BlockMasks masks = { 0, 0 };
+        for (size_t i = 0; i < size; ++i) {
+            const unsigned char c = static_cast<unsigned char>(data[i]);
+            masks.spaces |= static_cast<uint32_t>(c == ' ') << i;
+            masks.controls |= static_cast<uint32_t>(c < 0x20) << i;
+        }
+        return masks;
+    }
+
+    // Control characters are the bytes with the top three bits clear
+#if defined(TOKENIZER_USE_AVX2)
+    const size_t BLOCK_SIZE = 32;
+
+    BlockMasks ScanBlock(const char* data) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        const __m256i spaces = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+        const __m256i controls = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, _mm256_set1_epi8(static_cast<char>(0xE0))), _mm256_setzero_si256());
+        return { static_cast<uint32_t>(_mm256_movemask_epi8(spaces)), static_cast<uint32_t>(_mm256_movemask_epi8(controls)) };
+    }
+#elif defined(TOKENIZER_USE_SSE2)
+    const size_t BLOCK_SIZE = 16;
+
+    BlockMasks ScanBlock(const char* data) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i spaces = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+        const __m128i controls = _mm_cmpeq_epi8(_mm_and_si128(bytes, _mm_set1_epi8(static_cast<char>(0xE0))), _mm_setzero_si128());
+        return { static_cast<uint32_t>(_mm_movemask_epi8(spaces)), static_cast<uint32_t>(_mm_movemask_epi8(controls)) };
+    }
+#else
+    const size_t BLOCK_SIZE = 32;
+
+    BlockMasks ScanBlock(const char* data) {
+        return ScanBytes(data, BLOCK_SIZE);
+    }
+#endif
+
+    // value must not be zero
+    size_t CountTrailingZeros(uint32_t value) {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return static_cast<size_t>(__builtin_ctz(value));
+#endif
+    }
+
+}
+
 
 /*std::vector<std::string_view> SplitIntoWords(std::string_view text) {
     std::vector<std::string_view> result;
@@ -17,20 +90,50 @@
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text) {
     std::vector<std::string_view> words;
-    std::string_view ttext = text; ttext.remove_prefix(std::min(ttext.size(), ttext.find_first_not_of(" ")));
-    auto pos = ttext.find(' ', 0);
-    for (; !ttext.empty();) {
-        if (pos == 0) {
-            ttext.remove_prefix(pos + 1);
-            pos = ttext.find(' ', 0);
-            continue;
+    SplitIntoWords(text, words);
+    return words;
+}
+
+void SplitIntoWords(std::string_view text, std::vector<std::string_view>& words) {
+    SplitIntoValidWords(text, words);
+}
+
+bool SplitIntoValidWords(std::string_view text, std::vector<std::string_view>& words) {
+    words.clear();
+    const char* data = text.data();
+    uint32_t controls = 0;
+    bool in_word = false;
+    size_t word_begin = 0;
+    const auto split_block = [&](size_t block_begin, size_t block_size, BlockMasks masks) {
+        const uint32_t valid = block_size == 32 ? ~uint32_t{ 0 } : (uint32_t{ 1 } << block_size) - 1;
+        const uint32_t letters = ~masks.spaces & valid;
+        controls |= masks.controls & valid;
+        // Bits of the bytes that start or end a word, that is differ from the byte before them
+        uint32_t edges = (letters ^ ((letters << 1) | static_cast<uint32_t>(in_word))) & valid;
+        while (edges != 0) {
+            const size_t pos = block_begin + CountTrailingZeros(edges);
+            if (in_word) {
+                words.emplace_back(data + word_begin, pos - word_begin);
+            }
+            else {
+                word_begin = pos;
+            }
+            in_word = !in_word;
+            edges &= edges - 1;
         }
-        words.push_back(ttext.substr(0, pos == ttext.npos ? ttext.npos : pos));
-        if (pos == ttext.npos) break;
-        ttext.remove_prefix(std::min(ttext.size(), pos + 1));
-        pos = ttext.find(' ', 0);
+    };
+
+    size_t pos = 0;
+    for (; pos + BLOCK_SIZE <= text.size(); pos += BLOCK_SIZE) {
+        split_block(pos, BLOCK_SIZE, ScanBlock(data + pos));
     }
-    return words;
+    if (pos < text.size()) {
+        split_block(pos, text.size() - pos, ScanBytes(data + pos, text.size() - pos));
+    }
+    if (in_word) {
+        words.emplace_back(data + word_begin, text.size() - word_begin);
+    }
+    return controls == 0;
 }
 
 /*std::vector<std::string> SplitIntoWords(const std::string& text) {
@@ -8,6 +8,11 @@
 //    ,  
 //std::vector<std::string> SplitIntoWords(const std::string& text);
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
+// Replaces the contents of words, so a caller splitting many texts reuses one vector
+void SplitIntoWords(std::string_view text, std::vector<std::string_view>& words);
+// Same split that also checks the text for control characters (bytes 0x00-0x1F) in the same pass,
+// false if it has one. The text is scanned in SIMD blocks where SSE2 or AVX2 is available.
+bool SplitIntoValidWords(std::string_view text, std::vector<std::string_view>& words);
 
 using StringSet = std::set<std::string, std::less<>>;
 
@@ -0,0 +1,119 @@
+#include <stdexcept>
+#include <utility>
+
+#include "term_dictionary.h"
+
+using namespace std::string_literals;
+
+
+TermDictionary::TermDictionary(std::vector<std::string_view> words, MappedVector<uint64_t> hashes, MappedVector<uint32_t> slots)
+    : terms_(std::move(words))
+    , hashes_(std::move(hashes))
+    , slots_(std::move(slots)) {
+    const size_t slot_count = slots_.size();
+    // Slots are found with a mask, so their count is a power of two. No slots at all only fit no words.
+    if (hashes_.size() != terms_.size() || (slot_count & (slot_count - 1)) != 0 || (slot_count == 0 && !terms_.empty())) {
+        throw std::invalid_argument("Term table does not fit the words"s);
+    }
+    size_t free_slot_count = 0;
+    for (uint32_t term_id : slots_) {
+        if (term_id == NO_TERM) {
+            ++free_slot_count;
+        }
+        else if (term_id >= terms_.size()) {
+            throw std::invalid_argument("Term table does not fit the words"s);
+        }
+    }
+    // A probe sequence only ends at a free slot, so looking up a new word in a full table never returns
+    if (slot_count > 0 && free_slot_count == 0) {
+        throw std::invalid_argument("Term table does not fit the words"s);
+    }
+}
+
+TermDictionary::TermDictionary(const TermDictionary& other) {
+    hashes_.assign(other.hashes_.begin(), other.hashes_.end());
+    slots_.assign(other.slots_.begin(), other.slots_.end());
+    terms_.reserve(other.terms_.size());
+    for (std::string_view word : other.terms_) {
+        terms_.push_back(bytes_.Store(word));
+    }
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        TermDictionary copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+uint32_t TermDictionary::Intern(std::string_view word) {
+    // At most half of the slots are taken, so probe sequences stay short
+    if ((terms_.size() + 1) * 2 > slots_.size()) {
+        Grow();
+    }
+    const uint64_t hash = Hash(word);
+    const size_t slot = FindSlot(word, hash);
+    if (slots_[slot] != NO_TERM) {
+        return slots_[slot];
+    }
+    const uint32_t term_id = static_cast<uint32_t>(terms_.size());
+    terms_.push_back(bytes_.Store(word));
+    hashes_.push_back(hash);
+    slots_[slot] = term_id;
+    return term_id;
+}
+
+uint32_t TermDictionary::Find(std::string_view word) const {
+    if (slots_.empty()) {
+        return NO_TERM;
+    }
+    return slots_[FindSlot(word, Hash(word))];
+}
+
+const std::vector<std::string_view>& TermDictionary::GetWords() const {
+    return terms_;
+}
+
+const MappedVector<uint64_t>& TermDictionary::GetHashes() const {
+    return hashes_;
+}
+
+const MappedVector<uint32_t>& TermDictionary::GetSlots() const {
+    return slots_;
+}
+
+size_t TermDictionary::size() const {
+    return terms_.size();
+}
+
+uint64_t TermDictionary::Hash(std::string_view word) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : word) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t TermDictionary::FindSlot(std::string_view word, uint64_t hash) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = static_cast<size_t>(hash) & mask; ; slot = (slot + 1) & mask) {
+        const uint32_t term_id = slots_[slot];
+        if (term_id == NO_TERM || (hashes_[term_id] == hash && terms_[term_id] == word)) {
+            return slot;
+        }
+    }
+}
+
+void TermDictionary::Grow() {
+    slots_.assign(slots_.empty() ? 16 : slots_.size() * 2, NO_TERM);
+    const size_t mask = slots_.size() - 1;
+    for (uint32_t term_id = 0; term_id < terms_.size(); ++term_id) {
+        size_t slot = static_cast<size_t>(hashes_[term_id]) & mask;
+        while (slots_[slot] != NO_TERM) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = term_id;
+    }
+}
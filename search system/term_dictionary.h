@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "mapped_vector.h"
+#include "string_arena.h"
+
+
+// Terms numbered in order of addition. The bytes of all terms live in one arena and lookups go
+// through an open addressing table of term ids, so a term costs no heap block of its own.
+// The table hashes with FNV-1a, so it can be saved and used again by another build or process.
+// A copy stores the terms and the table again in storage of its own, with the same ids.
+class TermDictionary {
+public:
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+
+    TermDictionary() = default;
+    // Dictionary over words, hashes and slots saved from another one, which may view a mapped
+    // snapshot and must then outlive the dictionary. Nothing is hashed or stored again.
+    // Throws std::invalid_argument if the table does not fit the words.
+    TermDictionary(std::vector<std::string_view> words, MappedVector<uint64_t> hashes, MappedVector<uint32_t> slots);
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    // Returns the id of the word, adding it with the next id if it is new
+    uint32_t Intern(std::string_view word);
+
+    // NO_TERM if the word was never added
+    uint32_t Find(std::string_view word) const;
+
+    std::string_view operator[](uint32_t term_id) const {
+        return terms_[term_id];
+    }
+
+    // Words by term id, valid while the dictionary lives
+    const std::vector<std::string_view>& GetWords() const;
+
+    // Hash of every term by term id and the table of term ids, as the constructor takes them
+    const MappedVector<uint64_t>& GetHashes() const;
+    const MappedVector<uint32_t>& GetSlots() const;
+
+    size_t size() const;
+
+private:
+    StringArena bytes_;
+    std::vector<std::string_view> terms_;
+    // Hash of every term, so growing the table does not hash the words again
+    MappedVector<uint64_t> hashes_;
+    // Term ids by hash with linear probing, NO_TERM marks a free slot. The size is a power of two.
+    MappedVector<uint32_t> slots_;
+
+    static uint64_t Hash(std::string_view word);
+    // Slot holding the word or the free slot where it would go
+    size_t FindSlot(std::string_view word, uint64_t hash) const;
+    void Grow();
+};
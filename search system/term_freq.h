@@ -0,0 +1,56 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+
+// How posting lists store term frequency. TF lies in (0; 1], so a 16-bit fixed point keeps
+// about 5 significant digits for ordinary documents.
+// Define SEARCH_SERVER_TF_FLOAT or SEARCH_SERVER_TF_UINT16 to change the default double.
+
+struct DoubleTermFreq {
+    using Stored = double;
+
+    static Stored Encode(double term_freq) {
+        return term_freq;
+    }
+    static double Decode(Stored stored) {
+        return stored;
+    }
+};
+
+struct FloatTermFreq {
+    using Stored = float;
+
+    static Stored Encode(double term_freq) {
+        return static_cast<float>(term_freq);
+    }
+    static double Decode(Stored stored) {
+        return stored;
+    }
+};
+
+struct FixedPointTermFreq {
+    using Stored = uint16_t;
+
+    static constexpr double SCALE = 65535.0;
+
+    static Stored Encode(double term_freq) {
+        const double scaled = std::round(term_freq * SCALE);
+        // A word that occurs in the document must not lose its posting weight entirely
+        if (scaled < 1.0) {
+            return 1;
+        }
+        return scaled > SCALE ? UINT16_MAX : static_cast<Stored>(scaled);
+    }
+    static double Decode(Stored stored) {
+        return stored * (1.0 / SCALE);
+    }
+};
+
+#if defined(SEARCH_SERVER_TF_UINT16)
+using TermFreqCodec = FixedPointTermFreq;
+#elif defined(SEARCH_SERVER_TF_FLOAT)
+using TermFreqCodec = FloatTermFreq;
+#else
+using TermFreqCodec = DoubleTermFreq;
+#endif
@@ -8,16 +8,114 @@
 #include <vector>
 #include <sstream>
 #include <random>
+#include <climits>
+#include <atomic>
+#include <thread>
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <mutex>
 
 #include "test_example_functions.h"
 #include "search_server.h"
 #include "remove_duplicates.h"
 #include "process_queries.h"
 #include "paginator.h"
+#include "posting_list.h"
+#include "compressed_posting_list.h"
+#include "ranking_drift.h"
+#include "score_accumulator.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
+#include "concurrent_search_server.h"
+#include "sharded_search_server.h"
+#include "durable_search_server.h"
+#include "ingest_pipeline.h"
+#include "term_dictionary.h"
+#include "document_ids.h"
+#include "query_context.h"
+#include "stop_word_filter.h"
+#include "file_sync.h"
 
 using namespace std;
 
 
+// Выделения памяти через new в текущем потоке, для проверки поиска без выделений.
+// Заменены все формы new и delete, кроме выровненных: память любой формы берётся из malloc
+// и возвращается через free, поэтому пары выделения и освобождения всегда совпадают.
+namespace {
+    thread_local size_t allocation_count = 0;
+
+    void* CountedAllocate(size_t size) {
+        ++allocation_count;
+        if (void* memory = malloc(size == 0 ? 1 : size)) {
+            return memory;
+        }
+        throw bad_alloc();
+    }
+}
+
+void* operator new(size_t size) {
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size) {
+    return CountedAllocate(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    try {
+        return CountedAllocate(size);
+    }
+    catch (const bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    try {
+        return CountedAllocate(size);
+    }
+    catch (const bad_alloc&) {
+        return nullptr;
+    }
+}
+
+// GCC видит free после встроенного operator new и сообщает о несовпадении, хотя обе стороны заменены
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, const nothrow_t&) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory, const nothrow_t&) noexcept {
+    free(memory);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+
 void AssertImpl(bool value, const string& expr_str, const string& file, const string& func, unsigned line,
     const string& hint) {
     if (!value) {
@@ -406,6 +504,578 @@ void TestRemoveDocuments() {
     report();
 }
 
+// Документы добавляются не по порядку id, слова повторяются, часть документов удаляется
+void TestWordFrequencies() {
+    SearchServer server("and"s);
+    server.AddDocument(7, "cat and dog and cat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(3, "dog bird"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(5, "cat"s, DocumentStatus::ACTUAL, { 3 });
+
+    const auto& freqs = server.GetWordFrequencies(7);
+    ASSERT_EQUAL(freqs.size(), 2u);
+    ASSERT(abs(freqs.at("cat"sv) - TermFreqCodec::Decode(TermFreqCodec::Encode(2.0 / 3.0))) < EPSILON);
+    ASSERT(abs(freqs.at("dog"sv) - TermFreqCodec::Decode(TermFreqCodec::Encode(1.0 / 3.0))) < EPSILON);
+    ASSERT(server.GetWordFrequencies(42).empty());
+
+    const auto found = server.FindTopDocuments("cat"s);
+    ASSERT_EQUAL(found.size(), 2u);
+    ASSERT_EQUAL(found[0].id, 5);
+    ASSERT(abs(found[0].relevance - log(3.0 / 2.0)) < EPSILON);
+
+    server.RemoveDocument(5);
+    server.RemoveDocument(execution::par, 7);
+    ASSERT(server.FindTopDocuments("cat"s).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("dog -cat"s).size(), 1u);
+    const auto [words, status] = server.MatchDocument("bird dog cat"s, 3);
+    ASSERT_EQUAL(words.size(), 2u);
+}
+
+// Сжатый список должен вести себя так же, как обычный, в том числе на границах блоков
+void TestCompressedPostingList() {
+    mt19937 generator(7);
+    PostingList plain;
+    CompressedPostingList compressed;
+    int document_id = 0;
+    for (int i = 0; i < 1000; ++i) {
+        // Small and huge gaps give blocks of different bit width
+        document_id += i % 300 == 0 ? 1'000'000 : uniform_int_distribution<>(1, 40)(generator);
+        plain.Add(document_id, i);
+        compressed.Add(document_id, i);
+    }
+    for (int id : { 5, 17, 1'000'003 }) {
+        plain.Add(id, 0.5);
+        compressed.Add(id, 0.5);
+    }
+    for (int id : { 5, 1'000'000, 1'000'003, document_id }) {
+        ASSERT_EQUAL(plain.Erase(id), compressed.Erase(id));
+    }
+
+    vector<pair<int, double>> expected, actual;
+    plain.ForEach([&expected](int id, double tf) { expected.push_back({ id, tf }); });
+    compressed.ForEach([&actual](int id, double tf) { actual.push_back({ id, tf }); });
+    ASSERT_EQUAL(compressed.size(), plain.size());
+    ASSERT(expected == actual);
+    for (const auto& [id, tf] : expected) {
+        ASSERT(compressed.Contains(id));
+        ASSERT_EQUAL(compressed.GetTermFreq(id), tf);
+        ASSERT(!compressed.Contains(id + 1) || plain.Contains(id + 1));
+    }
+}
+
+// Квантованный TF не должен заметно менять ранжирование
+void TestTermFreqPrecision() {
+    for (double tf : { 1.0, 0.5, 1.0 / 3.0, 1e-3, 1e-6 }) {
+        ASSERT_EQUAL(DoubleTermFreq::Decode(DoubleTermFreq::Encode(tf)), tf);
+        ASSERT(abs(FloatTermFreq::Decode(FloatTermFreq::Encode(tf)) - tf) <= tf * 1e-7);
+        ASSERT(abs(FixedPointTermFreq::Decode(FixedPointTermFreq::Encode(tf)) - tf) <= 1.0 / FixedPointTermFreq::SCALE);
+    }
+    ASSERT(FixedPointTermFreq::Encode(1e-9) > 0);
+
+    const vector<string> documents = {
+        "white cat and yellow hat"s,
+        "curly cat curly tail"s,
+        "nasty dog with big eyes"s,
+        "nasty pigeon john"s,
+    };
+    SearchServer server("and with"s);
+    for (size_t id = 0; id < documents.size(); ++id) {
+        server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, { 1 });
+    }
+    const auto drift = MeasureRankingDrift(server, "and with"sv, documents, { "curly nasty cat"s, "pigeon -john"s, "tail hat"s });
+    ASSERT_EQUAL(drift.query_count, 3u);
+    ASSERT_EQUAL(drift.changed_queries, 0u);
+    ASSERT(drift.max_relevance_error < 1e-4);
+}
+
+// Внешние id переводятся во внутренние порядковые номера и обратно
+void TestDocumentOrdinals() {
+    SearchServer server;
+    server.AddDocument(100, "big cat"s, DocumentStatus::ACTUAL, { 5 });
+    server.AddDocument(3, "small cat"s, DocumentStatus::BANNED, { 7 });
+    server.AddDocument(50, "cat"s, DocumentStatus::ACTUAL, { 9 });
+
+    const auto odd = server.FindTopDocuments("cat"s, [](int id, DocumentStatus, int) { return id % 2 == 1; });
+    ASSERT_EQUAL(odd.size(), 1u);
+    ASSERT_EQUAL(odd[0].id, 3);
+    ASSERT_EQUAL(odd[0].rating, 7);
+
+    server.RemoveDocument(3);
+    server.AddDocument(3, "small dog"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(server.GetDocumentCount(), 3);
+    const auto dogs = server.FindTopDocuments("dog"s);
+    ASSERT_EQUAL(dogs.size(), 1u);
+    ASSERT_EQUAL(dogs[0].id, 3);
+    ASSERT_EQUAL(dogs[0].rating, 1);
+    ASSERT_EQUAL(get<0>(server.MatchDocument("small cat"s, 3)).size(), 1u);
+
+    bool thrown = false;
+    try {
+        server.MatchDocument("cat"s, 4);
+    }
+    catch (const out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+// IDF пересчитывается при добавлении и удалении документов
+void TestInverseDocumentFreqCache() {
+    SearchServer server;
+    server.AddDocument(1, "cat dog"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "cat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(3, "bird"s, DocumentStatus::ACTUAL, { 1 });
+    // TF of "dog" as the selected codec stores it
+    const double dog_term_freq = TermFreqCodec::Decode(TermFreqCodec::Encode(0.5));
+    ASSERT(abs(server.FindTopDocuments("dog"s)[0].relevance - dog_term_freq * log(3.0)) < EPSILON);
+
+    server.RemoveDocument(3);
+    ASSERT(abs(server.FindTopDocuments("dog"s)[0].relevance - dog_term_freq * log(2.0)) < EPSILON);
+    ASSERT(abs(server.FindTopDocuments("cat"s)[0].relevance) < EPSILON);
+
+    // Слово, которого больше нет ни в одном документе, не должно давать деления на ноль
+    server.RemoveDocument(execution::par, 2);
+    server.RemoveDocument(1);
+    server.AddDocument(4, "dog"s, DocumentStatus::ACTUAL, { 1 });
+    const auto found = server.FindTopDocuments("cat dog"s);
+    ASSERT_EQUAL(found.size(), 1u);
+    ASSERT(isfinite(found[0].relevance));
+    ASSERT(server.FindTopDocuments(execution::par, "cat"s).empty());
+}
+
+// Количество возвращаемых документов задаётся при вызове
+void TestTopDocumentCount() {
+    SearchServer server;
+    string text;
+    for (int id = 0; id < 30; ++id) {
+        text += " word"s + to_string(id);
+        server.AddDocument(id, "cat"s + text, DocumentStatus::ACTUAL, { id % 4 });
+    }
+    server.AddDocument(100, "dog"s, DocumentStatus::ACTUAL, { 1 });
+
+    ASSERT_EQUAL(server.FindTopDocuments("cat"s).size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 0).empty());
+    const auto all = server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 100);
+    ASSERT_EQUAL(all.size(), 30u);
+    for (size_t top_count : { 1, 10, 20 }) {
+        const auto top = server.FindTopDocuments(execution::par, "cat"s, DocumentStatus::ACTUAL, top_count);
+        ASSERT_EQUAL(top.size(), top_count);
+        for (size_t i = 0; i < top_count; ++i) {
+            ASSERT_EQUAL(top[i].id, all[i].id);
+        }
+    }
+    const auto even = server.FindTopDocuments("cat"s, [](int id, DocumentStatus, int) { return id % 2 == 0; }, 20);
+    ASSERT_EQUAL(even.size(), 15u);
+}
+
+// WAND должен возвращать те же документы, что и полный перебор
+void TestWandSearch() {
+    mt19937 generator(11);
+    vector<string> words;
+    for (int i = 0; i < 40; ++i) {
+        words.push_back("w"s + to_string(i));
+    }
+    // Skewed word choice gives long postings of several blocks next to short ones
+    const auto random_word = [&]() {
+        const int index = uniform_int_distribution<>(0, 39)(generator);
+        return words[index * index / 40];
+    };
+    SearchServer server("w0"s);
+    for (int id = 0; id < 3000; ++id) {
+        string text;
+        const int word_count = uniform_int_distribution<>(1, 12)(generator);
+        for (int i = 0; i < word_count; ++i) {
+            text += random_word() + " "s;
+        }
+        const auto status = id % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id * 3, text, status, { uniform_int_distribution<>(-5, 5)(generator) });
+    }
+    for (int id = 0; id < 3000; id += 13) {
+        server.RemoveDocument(id * 3);
+    }
+
+    PostingList plain;
+    CompressedPostingList compressed;
+    for (int id = 0; id < 1000; id += 1 + id % 3) {
+        plain.Add(id, (id % 11 + 1) / 11.0);
+        compressed.Add(id, (id % 11 + 1) / 11.0);
+    }
+    PostingList::Cursor plain_cursor(plain);
+    CompressedPostingList::Cursor compressed_cursor(compressed);
+    for (int target : { 0, 5, 127, 128, 400, 401, 998, 1000 }) {
+        plain_cursor.Advance(target);
+        compressed_cursor.Advance(target);
+        ASSERT_EQUAL(plain_cursor.AtEnd(), compressed_cursor.AtEnd());
+        if (!plain_cursor.AtEnd()) {
+            ASSERT_EQUAL(plain_cursor.GetDocumentId(), compressed_cursor.GetDocumentId());
+            ASSERT_EQUAL(plain_cursor.GetTermFreq(), compressed_cursor.GetTermFreq());
+            ASSERT(plain_cursor.GetBlockBound(target).max_term_freq >= plain_cursor.GetTermFreq());
+            ASSERT(compressed_cursor.GetBlockBound(target).max_term_freq >= compressed_cursor.GetTermFreq());
+        }
+    }
+    ASSERT_EQUAL(plain.GetMaxTermFreq(), 1.0);
+    ASSERT_EQUAL(compressed.GetMaxTermFreq(), 1.0);
+
+    const auto is_odd = [](int id, DocumentStatus, int rating) { return id % 2 == 1 && rating >= 0; };
+    for (int i = 0; i < 200; ++i) {
+        string query;
+        const int word_count = uniform_int_distribution<>(1, 6)(generator);
+        for (int j = 0; j < word_count; ++j) {
+            query += (uniform_int_distribution<>(0, 9)(generator) == 0 ? "-"s : ""s) + random_word() + " "s;
+        }
+        map<int, double> relevances;
+        for (const Document& document : server.FindTopDocuments(query, DocumentStatus::ACTUAL, 3000)) {
+            relevances[document.id] = document.relevance;
+        }
+        for (size_t top_count : { 1, 5, 50 }) {
+            const auto expected = server.FindTopDocuments(query, DocumentStatus::ACTUAL, top_count);
+            const auto actual = server.FindTopDocuments(SearchMode::WAND, query, DocumentStatus::ACTUAL, top_count);
+            ASSERT_EQUAL(actual.size(), expected.size());
+            // Documents tied by relevance and rating may come in any order
+            for (size_t k = 0; k < actual.size(); ++k) {
+                ASSERT_EQUAL(actual[k].relevance, relevances.at(actual[k].id));
+                ASSERT(abs(actual[k].relevance - expected[k].relevance) < EPSILON);
+                ASSERT_EQUAL(actual[k].rating, expected[k].rating);
+            }
+        }
+        const SearchMode mode = SearchMode::WAND;
+        const auto expected = server.FindTopDocuments(query, is_odd, 20);
+        const auto actual = server.FindTopDocuments(mode, query, is_odd, 20);
+        ASSERT_EQUAL(actual.size(), expected.size());
+        for (size_t k = 0; k < actual.size(); ++k) {
+            ASSERT(is_odd(actual[k].id, DocumentStatus::ACTUAL, actual[k].rating));
+            ASSERT(abs(actual[k].relevance - expected[k].relevance) < EPSILON);
+        }
+    }
+    ASSERT(server.FindTopDocuments(SearchMode::WAND, "w1"s, DocumentStatus::ACTUAL, 0).empty());
+    ASSERT(server.FindTopDocuments(SearchMode::WAND, "unknown"s).empty());
+}
+
+// Аккумулятор релевантности должен обнуляться между запросами без очистки массива
+void TestScoreAccumulator() {
+    ScoreAccumulator accumulator;
+    accumulator.Reset(10);
+    accumulator.Add(7, 0.5);
+    accumulator.Add(2, 1.0);
+    accumulator.Add(7, 0.25);
+    ASSERT(accumulator.Contains(7));
+    ASSERT(accumulator.Contains(2));
+    ASSERT(!accumulator.Contains(3));
+    ASSERT_EQUAL(accumulator.Get(7), 0.75);
+    ASSERT_EQUAL(accumulator.GetTouched(), vector<int>({ 7, 2 }));
+
+    // Reuse with a larger range forgets the previous query
+    accumulator.Reset(20);
+    ASSERT(accumulator.GetTouched().empty());
+    ASSERT(!accumulator.Contains(7));
+    accumulator.Add(15, 2.0);
+    accumulator.Add(7, 1.0);
+    ASSERT_EQUAL(accumulator.Get(7), 1.0);
+    accumulator.SortTouched();
+    ASSERT_EQUAL(accumulator.GetTouched(), vector<int>({ 7, 15 }));
+
+    // Полный перебор и WAND находят одни и те же документы
+    SearchServer server("and"s);
+    for (int id = 0; id < 200; ++id) {
+        server.AddDocument(id, "cat "s + (id % 3 == 0 ? "dog "s : ""s) + (id % 5 == 0 ? "and bird"s : "fish"s), DocumentStatus::ACTUAL, { id % 7 });
+    }
+    for (const string& query : { "cat dog"s, "dog -bird"s, "fish -cat"s, "bird dog fish"s }) {
+        const auto expected = server.FindTopDocuments(SearchMode::WAND, query, DocumentStatus::ACTUAL, 200);
+        const auto actual = server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, 200);
+        ASSERT_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            ASSERT(abs(actual[i].relevance - expected[i].relevance) < EPSILON);
+            ASSERT_EQUAL(actual[i].rating, expected[i].rating);
+        }
+    }
+}
+
+// Минус-слова исключают документы во всех вариантах поиска, в том числе в параллельном
+void TestMinusWordsExclusion() {
+    DocumentBitmap bitmap(130);
+    bitmap.Set(0);
+    bitmap.Set(64);
+    bitmap.Set(129);
+    bitmap.Reset(64);
+    ASSERT(bitmap.Test(0) && bitmap.Test(129));
+    ASSERT(!bitmap.Test(64) && !bitmap.Test(1));
+    bitmap.Assign(10);
+    ASSERT(!bitmap.Test(0));
+    ASSERT_EQUAL(bitmap.size(), 10u);
+
+    SearchServer server;
+    for (int id = 0; id < 300; ++id) {
+        string text = "cat"s;
+        if (id % 2 == 0) {
+            text += " spam"s;
+        }
+        if (id % 3 == 0) {
+            text += " dog"s;
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, { id });
+    }
+    for (const string& query : { "cat -spam"s, "cat dog -spam -dog"s, "dog -spam -unknown"s, "cat spam -spam"s }) {
+        set<int> expected;
+        for (int id = 0; id < 300; ++id) {
+            const auto [words, status] = server.MatchDocument(query, id);
+            if (!words.empty()) {
+                expected.insert(id);
+            }
+        }
+        const auto check = [&expected](const vector<Document>& documents) {
+            ASSERT_EQUAL(documents.size(), expected.size());
+            for (const Document& document : documents) {
+                ASSERT(expected.count(document.id));
+            }
+        };
+        check(server.FindTopDocuments(query, DocumentStatus::ACTUAL, 300));
+        check(server.FindTopDocuments(execution::seq, query, DocumentStatus::ACTUAL, 300));
+        check(server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, 300));
+        check(server.FindTopDocuments(SearchMode::WAND, query, DocumentStatus::ACTUAL, 300));
+    }
+}
+
+// Поиск по статусу через битовые карты совпадает с поиском по предикату
+void TestStatusBitmaps() {
+    DocumentBitmap bitmap;
+    bitmap.Assign(70, true);
+    bitmap.Resize(130);
+    ASSERT(bitmap.Test(69));
+    ASSERT(!bitmap.Test(70) && !bitmap.Test(129));
+
+    const DocumentStatus statuses[] = { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED };
+    SearchServer server;
+    for (int id = 0; id < 200; ++id) {
+        server.AddDocument(id, id % 5 == 0 ? "cat dog"s : "cat"s, statuses[id % 4], { id });
+    }
+    server.RemoveDocument(4);
+    server.RemoveDocument(8);
+    server.AddDocument(8, "cat"s, DocumentStatus::BANNED, { 8 });
+
+    for (DocumentStatus status : statuses) {
+        const auto by_status = [status](int, DocumentStatus document_status, int) { return document_status == status; };
+        for (const string& query : { "cat"s, "cat -dog"s, "dog"s }) {
+            const auto expected = server.FindTopDocuments(query, by_status, 200);
+            const auto check = [&expected](const vector<Document>& documents) {
+                ASSERT_EQUAL(documents.size(), expected.size());
+                for (size_t i = 0; i < documents.size(); ++i) {
+                    ASSERT_EQUAL(documents[i].id, expected[i].id);
+                }
+            };
+            check(server.FindTopDocuments(query, status, 200));
+            check(server.FindTopDocuments(execution::par, query, status, 200));
+            check(server.FindTopDocuments(SearchMode::WAND, query, status, 200));
+        }
+    }
+    const auto banned = server.FindTopDocuments("cat"s, DocumentStatus::BANNED, 200);
+    ASSERT(any_of(banned.begin(), banned.end(), [](const Document& document) { return document.id == 8; }));
+    const auto actual = server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 200);
+    ASSERT(none_of(actual.begin(), actual.end(), [](const Document& document) { return document.id == 4 || document.id == 8; }));
+}
+
+// Декларативный фильтр отбирает те же документы, что и эквивалентный предикат
+void TestDocumentFilter() {
+    mt19937 generator(3);
+    for (size_t size : { 0, 5, 64, 65, 200 }) {
+        vector<int> values(size);
+        for (int& value : values) {
+            value = uniform_int_distribution<>(-10, 10)(generator);
+        }
+        if (size > 0) {
+            values[0] = INT_MIN;
+            values[size - 1] = INT_MAX;
+        }
+        DocumentBitmap bitmap;
+        bitmap.Assign(size, true);
+        bitmap.AssignRange(values.data(), -3, 4);
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQUAL(bitmap.Test(static_cast<int>(i)), -3 <= values[i] && values[i] <= 4);
+        }
+        bitmap.Flip();
+        for (size_t i = 0; i < size; ++i) {
+            ASSERT_EQUAL(bitmap.Test(static_cast<int>(i)), values[i] < -3 || 4 < values[i]);
+        }
+    }
+
+    const DocumentStatus statuses[] = { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED, DocumentStatus::REMOVED };
+    SearchServer server;
+    for (int id = 0; id < 300; ++id) {
+        server.AddDocument(id * 2, id % 3 == 0 ? "cat dog"s : "cat"s, statuses[id % 4], { id % 11 - 5 });
+    }
+    server.RemoveDocument(10);
+
+    using Filter = DocumentFilter;
+    const vector<Filter> filters = {
+        Filter(),
+        Filter::RatingAtLeast(3),
+        Filter::RatingAtLeast(3) && Filter::StatusIn({ DocumentStatus::ACTUAL }),
+        Filter::IdBetween(100, 399) || Filter::RatingBetween(-5, -4),
+        !Filter::StatusIn({ DocumentStatus::BANNED, DocumentStatus::REMOVED }) && !Filter::IdBetween(0, 50),
+    };
+    for (const Filter& filter : filters) {
+        for (const string& query : { "cat"s, "dog"s, "cat -dog"s }) {
+            const auto expected = server.FindTopDocuments(query, [&filter](int id, DocumentStatus status, int rating) {
+                return filter(id, status, rating);
+                }, 600);
+            // Ratings repeat, so tied documents may come in any order
+            const auto ids = [](const vector<Document>& documents) {
+                set<int> result;
+                for (const Document& document : documents) {
+                    result.insert(document.id);
+                }
+                return result;
+            };
+            const auto check = [&](const vector<Document>& documents) {
+                ASSERT_EQUAL(documents.size(), expected.size());
+                ASSERT(ids(documents) == ids(expected));
+            };
+            check(server.FindTopDocuments(query, filter, 600));
+            check(server.FindTopDocuments(execution::par, query, filter, 600));
+            check(server.FindTopDocuments(SearchMode::WAND, query, filter, 600));
+        }
+    }
+}
+
+// Представления частот слов разных документов живут одновременно до изменения сервера
+void TestForwardIndex() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat and dog"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(2, "dog and white cat"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(3, "bird bird cat"s, DocumentStatus::ACTUAL, { 3 });
+    server.AddDocument(4, "cat"s, DocumentStatus::ACTUAL, { 4 });
+
+    WordFrequencies first = server.GetWordFrequencies(1);
+    WordFrequencies third = server.GetWordFrequencies(3);
+    ASSERT_EQUAL(first.size(), 3u);
+    ASSERT_EQUAL(third.size(), 2u);
+    ASSERT(abs(third.at("bird"sv) - TermFreqCodec::Decode(TermFreqCodec::Encode(2.0 / 3.0))) < EPSILON);
+    ASSERT(abs(first.at("cat"sv) - TermFreqCodec::Decode(TermFreqCodec::Encode(1.0 / 3.0))) < EPSILON);
+
+    map<string_view, double> words(first.begin(), first.end());
+    ASSERT_EQUAL(words.size(), 3u);
+    ASSERT_EQUAL(words.count("white"sv), 1u);
+    ASSERT_EQUAL(words.count("dog"sv), 1u);
+
+    // Частоты не меняются от добавления документов с новыми словами и идут в алфавитном порядке,
+    // после изменения сервера представления берутся заново
+    for (int id = 10; id < 1010; ++id) {
+        server.AddDocument(id, "word"s + to_string(id) + " cat"s, DocumentStatus::ACTUAL, { id });
+    }
+    first = server.GetWordFrequencies(1);
+    third = server.GetWordFrequencies(3);
+    vector<pair<string_view, double>> expected_words = { { "cat"sv, 1.0 / 3.0 }, { "dog"sv, 1.0 / 3.0 }, { "white"sv, 1.0 / 3.0 } };
+    ASSERT_EQUAL(first.size(), expected_words.size());
+    size_t index = 0;
+    for (const auto& [word, term_freq] : first) {
+        ASSERT_EQUAL(word, expected_words[index].first);
+        ASSERT(abs(term_freq - TermFreqCodec::Decode(TermFreqCodec::Encode(expected_words[index].second))) < EPSILON);
+        ++index;
+    }
+    ASSERT(abs(third.at("cat"sv) - TermFreqCodec::Decode(TermFreqCodec::Encode(1.0 / 3.0))) < EPSILON);
+    for (int id = 10; id < 1010; ++id) {
+        server.RemoveDocument(id);
+    }
+    // Порядок слов переносится вместе с документом при уплотнении
+    first = server.GetWordFrequencies(1);
+    index = 0;
+    for (const auto& [word, term_freq] : first) {
+        ASSERT_EQUAL(word, expected_words[index++].first);
+    }
+    ASSERT_EQUAL(index, expected_words.size());
+    ASSERT_EQUAL(server.GetDocumentTerms(1).size, 3u);
+    ASSERT_EQUAL(server.GetDocumentTerms(5).size, 0u);
+
+    bool thrown = false;
+    try {
+        first.at("bird"sv);
+    }
+    catch (const out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    // Документы 1 и 2 состоят из одних и тех же слов
+    RemoveDuplicates(server);
+    ASSERT_EQUAL(server.GetDocumentCount(), 3);
+    ASSERT(server.GetWordFrequencies(2).empty());
+    ASSERT_EQUAL(server.GetWordFrequencies(3).size(), 2u);
+    ASSERT(server.FindTopDocuments("dog"s).size() == 1u);
+
+    const string query = "white bird"s;
+    const auto [matched, status] = server.MatchDocument(query, 1);
+    ASSERT_EQUAL(matched.size(), 1u);
+    ASSERT_EQUAL(matched[0], "white"sv);
+    ASSERT(get<0>(server.MatchDocument("cat -bird"s, 3)).empty());
+}
+
+// Удалённые документы пропускаются сразу, а после сжатия индекс совпадает с построенным заново
+void TestTombstoneCompaction() {
+    const vector<string> words = { "cat"s, "dog"s, "bird"s, "fish"s, "rat"s };
+    const auto text = [&words](int id) {
+        string result = words[id % 5];
+        for (int i = 1; i <= id % 4; ++i) {
+            result += " "s + words[(id * i + 2) % 5];
+        }
+        return result;
+    };
+    SearchServer server;
+    for (int id = 0; id < 200; ++id) {
+        server.AddDocument(id, text(id), DocumentStatus::ACTUAL, { id });
+    }
+
+    const auto check = [&server, &text](const set<int>& removed) {
+        SearchServer expected_server;
+        for (int id = 0; id < 200; ++id) {
+            if (removed.count(id) == 0) {
+                expected_server.AddDocument(id, text(id), DocumentStatus::ACTUAL, { id });
+            }
+        }
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+        for (const string& query : { "cat"s, "dog bird"s, "fish -rat"s, "rat -cat -dog"s }) {
+            const auto expected = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 200);
+            for (const auto& found : {
+                server.FindTopDocuments(query, DocumentStatus::ACTUAL, 200),
+                server.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; }, 200),
+                server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, 200),
+                server.FindTopDocuments(SearchMode::WAND, query, DocumentStatus::ACTUAL, 200),
+                server.FindTopDocuments(query, DocumentFilter::RatingAtLeast(0), 200) }) {
+                ASSERT_EQUAL(found.size(), expected.size());
+                for (size_t i = 0; i < found.size(); ++i) {
+                    ASSERT_EQUAL(found[i].id, expected[i].id);
+                    ASSERT(abs(found[i].relevance - expected[i].relevance) < EPSILON);
+                }
+            }
+        }
+    };
+
+    // Несколько удалений остаются надгробиями
+    set<int> removed = { 3, 50, 51, 199 };
+    for (int id : removed) {
+        server.RemoveDocument(id);
+    }
+    server.RemoveDocument(3);
+    check(removed);
+    ASSERT(server.GetWordFrequencies(50).empty());
+
+    vector<int> batch;
+    for (int id = 0; id < 200; id += 3) {
+        batch.push_back(id);
+        removed.insert(id);
+    }
+    batch.push_back(1000);
+    server.RemoveDocuments(execution::par, batch);
+    check(removed);
+
+    server.RemoveDocuments({ 1, 2 });
+    removed.insert(1);
+    removed.insert(2);
+    server.Compact(execution::par);
+    check(removed);
+
+    server.AddDocument(3, "whale"s, DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(server.FindTopDocuments("whale cat"s, DocumentStatus::ACTUAL, 200).size(), server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 200).size() + 1);
+    ASSERT_EQUAL(server.GetWordFrequencies(3).size(), 1u);
+}
+
 string GenerateWord(mt19937& generator, int max_length) {
     const int length = uniform_int_distribution<>(1, max_length)(generator);
     string word;
@@ -520,6 +1190,940 @@ void TestMatchDocument() {
     }
 }
 
+// Пакетное добавление строит тот же индекс, что и добавление по одному документу
+void TestAddDocumentsBatch() {
+    mt19937 generator(5);
+    const vector<string> dictionary = GenerateDictionary(generator, 300, 6);
+    vector<string> texts;
+    for (int i = 0; i < 500; ++i) {
+        texts.push_back(GenerateQuery(generator, dictionary, i % 20));
+    }
+    vector<DocumentInput> batch;
+    SearchServer expected_server(dictionary[0]);
+    for (int i = 0; i < 500; ++i) {
+        const DocumentStatus status = i % 7 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        batch.push_back({ i * 2, texts[i], status, { i % 13, 1 } });
+        expected_server.AddDocument(i * 2, texts[i], status, { i % 13, 1 });
+    }
+
+    SearchServer sequential_server(dictionary[0]);
+    sequential_server.AddDocuments(batch);
+    SearchServer parallel_server(dictionary[0]);
+    parallel_server.AddDocument(1, dictionary[1], DocumentStatus::ACTUAL, { 1 });
+    parallel_server.RemoveDocument(1);
+    parallel_server.AddDocuments(execution::par, batch);
+    parallel_server.AddDocuments(execution::par, {});
+
+    for (const SearchServer* server : { &sequential_server, &parallel_server }) {
+        ASSERT_EQUAL(server->GetDocumentCount(), expected_server.GetDocumentCount());
+        for (int id : expected_server) {
+            const auto expected = expected_server.GetWordFrequencies(id);
+            const auto freqs = server->GetWordFrequencies(id);
+            const map<string_view, double> expected_words(expected.begin(), expected.end());
+            const map<string_view, double> words(freqs.begin(), freqs.end());
+            ASSERT(words == expected_words);
+        }
+        for (int i = 0; i < 20; ++i) {
+            const string query = GenerateQuery(generator, dictionary, 3, 0.2);
+            const auto expected = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 50);
+            const auto found = server->FindTopDocuments(query, DocumentStatus::ACTUAL, 50);
+            ASSERT_EQUAL(found.size(), expected.size());
+            for (size_t j = 0; j < found.size(); ++j) {
+                ASSERT_EQUAL(found[j].id, expected[j].id);
+                ASSERT_EQUAL(found[j].rating, expected[j].rating);
+                ASSERT(abs(found[j].relevance - expected[j].relevance) < EPSILON);
+            }
+        }
+    }
+
+    // Ошибка в любом документе пакета отменяет весь пакет
+    const string invalid_text = "cat d\x12og"s;
+    const vector<vector<DocumentInput>> invalid_batches = {
+        { { 2000, "cat"sv, DocumentStatus::ACTUAL, {} }, { -1, "dog"sv, DocumentStatus::ACTUAL, {} } },
+        { { 2000, "cat"sv, DocumentStatus::ACTUAL, {} }, { 2000, "dog"sv, DocumentStatus::ACTUAL, {} } },
+        { { 2000, "cat"sv, DocumentStatus::ACTUAL, {} }, { 4, "dog"sv, DocumentStatus::ACTUAL, {} } },
+        { { 2000, "cat"sv, DocumentStatus::ACTUAL, {} }, { 2001, invalid_text, DocumentStatus::ACTUAL, {} } },
+    };
+    for (const auto& invalid_batch : invalid_batches) {
+        bool thrown = false;
+        try {
+            parallel_server.AddDocuments(execution::par, invalid_batch);
+        }
+        catch (const invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        ASSERT_EQUAL(parallel_server.GetDocumentCount(), 500);
+        ASSERT(parallel_server.FindTopDocuments("cat"s).empty());
+    }
+}
+
+// Запросы к индексу из нескольких сегментов дают тот же результат, что и к одному сегменту
+void TestIndexSegments() {
+    mt19937 generator(7);
+    const vector<string> dictionary = GenerateDictionary(generator, 200, 5);
+    vector<string> texts;
+    for (int i = 0; i < 400; ++i) {
+        texts.push_back(GenerateQuery(generator, dictionary, 1 + i % 15));
+    }
+    SearchServer expected_server;
+    SearchServer server;
+    for (int i = 0; i < 400; ++i) {
+        expected_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, { i % 17 });
+        server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, { i % 17 });
+        if (i % 50 == 49) {
+            server.Flush();
+        }
+    }
+    ASSERT(server.GetSegmentCount() >= 2u);
+
+    const auto check = [&] {
+        ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+        for (int i = 0; i < 30; ++i) {
+            const string query = GenerateQuery(generator, dictionary, 1 + i % 6, 0.2);
+            const auto expected = expected_server.FindTopDocuments(query, DocumentStatus::ACTUAL, 30);
+            for (const auto& found : {
+                server.FindTopDocuments(query, DocumentStatus::ACTUAL, 30),
+                server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL, 30),
+                server.FindTopDocuments(SearchMode::WAND, query, DocumentStatus::ACTUAL, 30) }) {
+                ASSERT_EQUAL(found.size(), expected.size());
+                for (size_t j = 0; j < found.size(); ++j) {
+                    ASSERT(abs(found[j].relevance - expected[j].relevance) < EPSILON);
+                    ASSERT_EQUAL(found[j].rating, expected[j].rating);
+                }
+            }
+        }
+    };
+    check();
+
+    // Копия сервера делит с оригиналом замороженные сегменты и фоновое слияние
+    const SearchServer copy = server;
+    server.WaitForMerges();
+    ASSERT(server.GetSegmentCount() < 9u);
+    check();
+    ASSERT_EQUAL(copy.GetDocumentCount(), 400);
+
+    for (int id = 0; id < 400; id += 7) {
+        expected_server.RemoveDocument(id);
+        server.RemoveDocument(id);
+    }
+    check();
+    server.Compact();
+    check();
+    for (int i = 0; i < 4; ++i) {
+        server.AddDocument(1000 + i, texts[i], DocumentStatus::ACTUAL, { 1 });
+        expected_server.AddDocument(1000 + i, texts[i], DocumentStatus::ACTUAL, { 1 });
+        server.Flush();
+    }
+    server.WaitForMerges();
+    check();
+}
+
+// Запросы из других потоков видят только целые версии индекса, пока в него пишут
+void TestConcurrentSearchServer() {
+    ConcurrentSearchServer server("and"s);
+    const int document_count = 400;
+    vector<string> texts;
+    for (int id = 0; id < document_count; ++id) {
+        texts.push_back("doc and word"s + to_string(id % 10) + " word"s + to_string(id % 7));
+    }
+
+    atomic<bool> done = false;
+    atomic<int> failures = 0;
+    vector<thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back([&server, &done, &failures] {
+            int last_count = 0;
+            while (!done) {
+                // Все документы содержат слово doc, поэтому в одной версии их число совпадает с числом найденных
+                const auto [count, found] = server.Read([](const SearchServer& snapshot) {
+                    return pair{ snapshot.GetDocumentCount(), snapshot.FindTopDocuments("doc"s, DocumentStatus::ACTUAL, 100'000).size() };
+                    });
+                if (static_cast<size_t>(count) != found || count < last_count) {
+                    ++failures;
+                }
+                last_count = count;
+                server.FindTopDocuments(SearchMode::WAND, "word3 -word5"s);
+            }
+            });
+    }
+
+    for (int id = 0; id < document_count / 2; ++id) {
+        server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+    }
+    for (int first = document_count / 2; first < document_count; first += 20) {
+        vector<DocumentInput> batch;
+        for (int id = first; id < first + 20; ++id) {
+            batch.push_back({ id, texts[id], DocumentStatus::ACTUAL, { id } });
+        }
+        server.AddDocuments(batch);
+    }
+    bool thrown = false;
+    try {
+        server.AddDocument(0, "doc"s, DocumentStatus::ACTUAL, {});
+    }
+    catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    done = true;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQUAL(failures.load(), 0);
+    ASSERT_EQUAL(server.GetDocumentCount(), document_count);
+
+    server.RemoveDocuments({ 1, 2, 3 });
+    server.RemoveDocument(4);
+    SearchServer expected_server("and"s);
+    for (int id = 5; id < document_count; ++id) {
+        expected_server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id });
+    }
+    const auto expected = expected_server.FindTopDocuments("word1 word2"s);
+    const auto found = server.FindTopDocuments("word1 word2"s);
+    ASSERT_EQUAL(found.size(), expected.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+        ASSERT_EQUAL(found[i].id, expected[i].id);
+    }
+    ASSERT(server.Read([](const SearchServer& snapshot) {
+        return snapshot.GetWordFrequencies(3).empty() && !snapshot.GetWordFrequencies(5).empty();
+        }));
+}
+
+// Шарды обмениваются частотами слов, поэтому ранжирование совпадает с одним сервером
+void TestShardedSearchServer() {
+    mt19937 generator(11);
+    const vector<string> dictionary = GenerateDictionary(generator, 150, 5);
+    vector<string> texts;
+    for (int i = 0; i < 600; ++i) {
+        texts.push_back(GenerateQuery(generator, dictionary, 1 + i % 12));
+    }
+    const auto status_of = [](int id) {
+        return id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+    };
+    SearchServer expected_server(dictionary[0]);
+    ShardedSearchServer server(4, dictionary[0]);
+    vector<DocumentInput> batch;
+    for (int id = 0; id < 600; ++id) {
+        expected_server.AddDocument(id, texts[id], status_of(id), { id });
+        if (id < 300) {
+            server.AddDocument(id, texts[id], status_of(id), { id });
+        }
+        else {
+            batch.push_back({ id, texts[id], status_of(id), { id } });
+        }
+    }
+    server.AddDocuments(batch);
+    for (int id = 0; id < 600; id += 9) {
+        expected_server.RemoveDocument(id);
+    }
+    vector<int> removed;
+    for (int id = 0; id < 600; id += 9) {
+        removed.push_back(id);
+    }
+    server.RemoveDocuments(removed);
+
+    ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+    for (size_t i = 0; i < server.GetShardCount(); ++i) {
+        ASSERT(server.GetShard(i).GetDocumentCount() > 0);
+    }
+    const auto check = [](const vector<Document>& found, const vector<Document>& expected) {
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+        }
+    };
+    for (int i = 0; i < 40; ++i) {
+        const string query = GenerateQuery(generator, dictionary, 1 + i % 5, 0.2);
+        check(server.FindTopDocuments(query), expected_server.FindTopDocuments(query));
+        check(server.FindTopDocuments(query, DocumentStatus::BANNED, 20), expected_server.FindTopDocuments(query, DocumentStatus::BANNED, 20));
+        const auto even = [](int id, DocumentStatus, int) {
+            return id % 2 == 0;
+        };
+        check(server.FindTopDocuments(query, even, 20), expected_server.FindTopDocuments(query, even, 20));
+        const auto filter = DocumentFilter::RatingBetween(100, 400);
+        check(server.FindTopDocuments(query, filter, 20), expected_server.FindTopDocuments(query, filter, 20));
+    }
+
+    const string query = dictionary[1] + " "s + dictionary[2];
+    ASSERT(server.MatchDocument(query, 1) == expected_server.MatchDocument(query, 1));
+    ASSERT_EQUAL(server.GetWordFrequencies(1).size(), expected_server.GetWordFrequencies(1).size());
+
+    // Пакет с ошибкой не добавляет ни одного документа ни в один шард
+    const string invalid_text = "cat d\x12og"s;
+    bool thrown = false;
+    try {
+        server.AddDocuments({ { 1000, "cat"sv, DocumentStatus::ACTUAL, {} }, { 1001, "cat"sv, DocumentStatus::ACTUAL, {} },
+            { 1002, "cat"sv, DocumentStatus::ACTUAL, {} }, { 1003, invalid_text, DocumentStatus::ACTUAL, {} } });
+    }
+    catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL(server.GetDocumentCount(), expected_server.GetDocumentCount());
+    ASSERT(server.FindTopDocuments("cat"s).empty());
+}
+
+// Снимок индекса загружается в сервер, который ищет так же, как исходный, а повреждённый файл отвергается
+void TestIndexSnapshot() {
+    mt19937 generator(13);
+    const vector<string> dictionary = GenerateDictionary(generator, 200, 6);
+    SearchServer server(dictionary[0] + " "s + dictionary[1]);
+    vector<string> texts;
+    for (int id = 0; id < 900; ++id) {
+        texts.push_back(GenerateQuery(generator, dictionary, 1 + id % 15));
+    }
+    for (int id = 0; id < 900; ++id) {
+        const DocumentStatus status = id % 7 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+        server.AddDocument(id * 3, texts[id], status, { id % 11, id % 5 });
+    }
+    for (int id = 0; id < 900; id += 4) {
+        server.RemoveDocument(id * 3);
+    }
+
+    const string path = (filesystem::temp_directory_path() / "search_server_test.snapshot"s).string();
+    server.SaveSnapshot(path);
+    const SearchServer loaded = SearchServer::LoadSnapshot(path, true);
+
+    ASSERT_EQUAL(loaded.GetDocumentCount(), server.GetDocumentCount());
+    ASSERT(equal(loaded.begin(), loaded.end(), server.begin(), server.end()));
+    const auto check = [](const vector<Document>& found, const vector<Document>& expected) {
+        ASSERT_EQUAL(found.size(), expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            ASSERT_EQUAL(found[i].id, expected[i].id);
+            ASSERT_EQUAL(found[i].relevance, expected[i].relevance);
+            ASSERT_EQUAL(found[i].rating, expected[i].rating);
+        }
+    };
+    for (int i = 0; i < 40; ++i) {
+        const string query = GenerateQuery(generator, dictionary, 1 + i % 6, 0.2);
+        check(loaded.FindTopDocuments(query), server.FindTopDocuments(query));
+        check(loaded.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 20), server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, 20));
+        check(loaded.FindTopDocuments(SearchMode::WAND, query), server.FindTopDocuments(SearchMode::WAND, query));
+    }
+    const string query = dictionary[0] + " "s + dictionary[2] + " "s + dictionary[3];
+    for (const int id : server) {
+        ASSERT(loaded.MatchDocument(query, id) == server.MatchDocument(query, id));
+        ASSERT_EQUAL(loaded.GetWordFrequencies(id).size(), server.GetWordFrequencies(id).size());
+    }
+
+    // Загруженный сервер принимает новые документы
+    SearchServer extended = SearchServer::LoadSnapshot(path);
+    extended.AddDocument(5000, dictionary[2], DocumentStatus::ACTUAL, { 1 });
+    ASSERT_EQUAL(extended.GetDocumentCount(), server.GetDocumentCount() + 1);
+    bool thrown = false;
+    try {
+        extended.AddDocument(3, dictionary[2], DocumentStatus::ACTUAL, { 1 });
+    }
+    catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+
+    // Изменения загруженного сервера копируют только затронутые массивы снимка, другие копии их не видят
+    {
+        SearchServer changed = SearchServer::LoadSnapshot(path);
+        SearchServer expected = server;
+        const SearchServer unchanged = changed;
+        for (SearchServer* target : { &changed, &expected }) {
+            target->RemoveDocument(3);
+            target->RemoveDocument(6);
+            target->Compact();
+            target->AddDocument(6000, texts[1], DocumentStatus::ACTUAL, { 1 });
+        }
+        for (int i = 0; i < 20; ++i) {
+            const string query = GenerateQuery(generator, dictionary, 1 + i % 6, 0.2);
+            check(changed.FindTopDocuments(query), expected.FindTopDocuments(query));
+            check(unchanged.FindTopDocuments(query), server.FindTopDocuments(query));
+        }
+    }
+
+    string bytes;
+    {
+        ifstream input(path, ios::binary);
+        bytes.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    }
+    const auto load_changed = [&](size_t pos, char value) {
+        string changed = bytes;
+        changed[pos] = value;
+        {
+            ofstream output(path, ios::binary | ios::trunc);
+            output.write(changed.data(), changed.size());
+        }
+        try {
+            SearchServer::LoadSnapshot(path, true);
+        }
+        catch (const runtime_error&) {
+            return false;
+        }
+        return true;
+    };
+    ASSERT(load_changed(0, bytes[0]));
+    // Байт посередине файла попадает в постинги и ловится полной проверкой, байт 8 - в номер версии
+    ASSERT(!load_changed(bytes.size() / 2, static_cast<char>(bytes[bytes.size() / 2] ^ 1)));
+    ASSERT(!load_changed(8, static_cast<char>(bytes[8] + 1)));
+    ASSERT(!load_changed(0, 'X'));
+
+    // Без проверки контрольных сумм номера терминов и документов вне диапазона всё равно отвергаются
+    const auto load_with_value = [&](uint32_t section_id, uint32_t value) {
+        // Заголовок и каждая запись таблицы разделов занимают по 32 байта, число разделов лежит по смещению 12
+        uint32_t section_count = 0;
+        memcpy(&section_count, bytes.data() + 12, sizeof(section_count));
+        string changed = bytes;
+        for (uint32_t i = 0; i < section_count; ++i) {
+            uint32_t id = 0;
+            uint64_t offset = 0;
+            memcpy(&id, bytes.data() + 32 + i * 32, sizeof(id));
+            memcpy(&offset, bytes.data() + 32 + i * 32 + 8, sizeof(offset));
+            if (id == section_id) {
+                memcpy(changed.data() + offset, &value, sizeof(value));
+            }
+        }
+        {
+            ofstream output(path, ios::binary | ios::trunc);
+            output.write(changed.data(), changed.size());
+        }
+        try {
+            SearchServer::LoadSnapshot(path);
+        }
+        catch (const runtime_error&) {
+            return false;
+        }
+        return true;
+    };
+    // Раздел 11 - номера терминов прямого индекса, раздел 13 - алфавитный порядок слов документа,
+    // раздел 15 (17 для сжатых списков) - номера документов в постингах
+#ifdef SEARCH_SERVER_COMPRESSED_POSTINGS
+    const uint32_t posting_ids_section = 17;
+#else
+    const uint32_t posting_ids_section = 15;
+#endif
+    ASSERT(load_with_value(0, 0));
+    ASSERT(!load_with_value(11, UINT32_MAX));
+    ASSERT(!load_with_value(13, UINT32_MAX));
+    ASSERT(!load_with_value(posting_ids_section, INT32_MAX));
+
+    filesystem::remove(path);
+    thrown = false;
+    try {
+        SearchServer::LoadSnapshot(path);
+    }
+    catch (const runtime_error&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+// Записи журнала переживают перезапуск, контрольная точка очищает журнал, а оборванный хвост отбрасывается
+void TestWriteAheadLog() {
+    const filesystem::path directory = filesystem::temp_directory_path();
+    const string snapshot_path = (directory / "search_server_wal_test.snapshot"s).string();
+    const string log_path = (directory / "search_server_wal_test.log"s).string();
+    filesystem::remove(snapshot_path);
+    filesystem::remove(log_path);
+
+    const vector<string> texts = {
+        "white cat and fancy collar"s, "fluffy cat fluffy tail"s, "groomed dog expressive eyes"s,
+        "groomed starling eugene"s, "fluffy dog and fancy collar"s, "white starling"s, "cat in a hat"s
+    };
+    SearchServer expected("and in"s);
+    const auto check = [&expected](const DurableSearchServer& server) {
+        ASSERT_EQUAL(server.GetDocumentCount(), expected.GetDocumentCount());
+        ASSERT(equal(server.GetServer().begin(), server.GetServer().end(), expected.begin(), expected.end()));
+        for (const string& query : { "fluffy cat"s, "groomed starling -eugene"s, "fancy collar white"s }) {
+            const auto found = server.FindTopDocuments(query, DocumentStatus::ACTUAL, 10);
+            const auto expected_found = expected.FindTopDocuments(query, DocumentStatus::ACTUAL, 10);
+            ASSERT_EQUAL(found.size(), expected_found.size());
+            for (size_t i = 0; i < found.size(); ++i) {
+                ASSERT_EQUAL(found[i].id, expected_found[i].id);
+                ASSERT_EQUAL(found[i].relevance, expected_found[i].relevance);
+                ASSERT_EQUAL(found[i].rating, expected_found[i].rating);
+            }
+        }
+    };
+
+    {
+        DurableSearchServer server(snapshot_path, log_path, "and in"s, { 4, true });
+        ASSERT_EQUAL(server.GetReplayedCount(), 0u);
+        for (int id = 0; id < 5; ++id) {
+            server.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id, 2 * id });
+            expected.AddDocument(id, texts[id], DocumentStatus::ACTUAL, { id, 2 * id });
+        }
+        server.RemoveDocument(1);
+        expected.RemoveDocument(1);
+        const vector<DocumentInput> batch = { { 10, texts[5], DocumentStatus::ACTUAL, { 7 } }, { 11, texts[6], DocumentStatus::BANNED, { 8 } } };
+        server.AddDocuments(batch);
+        expected.AddDocuments(batch);
+        // Отвергнутый документ не попадает в журнал
+        bool thrown = false;
+        try {
+            server.AddDocument(0, texts[0], DocumentStatus::ACTUAL, { 1 });
+        }
+        catch (const invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        server.AddDocument(1, texts[6], DocumentStatus::ACTUAL, { 9 });
+        expected.AddDocument(1, texts[6], DocumentStatus::ACTUAL, { 9 });
+        server.Sync();
+    }
+    {
+        DurableSearchServer server(snapshot_path, log_path, "and in"s);
+        ASSERT_EQUAL(server.GetReplayedCount(), 9u);
+        check(server);
+        server.Checkpoint();
+        ASSERT_EQUAL(filesystem::file_size(log_path), 0u);
+        server.AddDocument(20, texts[2], DocumentStatus::ACTUAL, { 3 });
+        expected.AddDocument(20, texts[2], DocumentStatus::ACTUAL, { 3 });
+    }
+    const uintmax_t log_size = filesystem::file_size(log_path);
+    {
+        // Оборванная последняя запись не применяется и отрезается
+        ofstream output(log_path, ios::binary | ios::app);
+        output.write("\x20\0\0\0\0\0\0\0garbage", 15);
+    }
+    {
+        DurableSearchServer server(snapshot_path, log_path, "unused"s);
+        ASSERT_EQUAL(server.GetReplayedCount(), 1u);
+        ASSERT_EQUAL(filesystem::file_size(log_path), log_size);
+        check(server);
+        server.RemoveDocument(0);
+        expected.RemoveDocument(0);
+        server.Sync();
+    }
+
+    // Сбой между сохранением снимка и очисткой журнала: журнал повторяется поверх нового снимка
+    const string log_copy = log_path + ".copy"s;
+    filesystem::copy_file(log_path, log_copy, filesystem::copy_options::overwrite_existing);
+    {
+        DurableSearchServer server(snapshot_path, log_path, "and in"s);
+        server.Checkpoint();
+    }
+    filesystem::copy_file(log_copy, log_path, filesystem::copy_options::overwrite_existing);
+    {
+        DurableSearchServer server(snapshot_path, log_path, "and in"s);
+        ASSERT_EQUAL(server.GetReplayedCount(), 2u);
+        check(server);
+    }
+
+    // Неполная группа записывается без Sync не позже max_delay
+    filesystem::remove(log_path);
+    {
+        WriteAheadLogOptions options;
+        options.max_delay = chrono::milliseconds(1);
+        WriteAheadLog log(log_path, options);
+        log.AppendRemoveDocument(3);
+        const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+        while (filesystem::file_size(log_path) == 0 && chrono::steady_clock::now() < deadline) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        ASSERT(filesystem::file_size(log_path) > 0);
+    }
+    {
+        // Заголовок с огромным размером записи считается концом журнала
+        ofstream output(log_path, ios::binary | ios::app);
+        output.write("\xff\xff\xff\xff\0\0\0\0\0\0\0\0\0\0\0\0", 16);
+    }
+    {
+        WriteAheadLog log(log_path);
+        size_t removed = 0;
+        ASSERT_EQUAL(log.Replay([&removed](const LogRecord& record) {
+            removed += record.type == LogRecordType::REMOVE_DOCUMENT && record.document_id == 3;
+            }), 1u);
+        ASSERT_EQUAL(removed, 1u);
+    }
+
+    // Контрольная точка синхронизирует снимок, затем его каталог, и только после этого обрезает журнал
+    {
+        DurableSearchServer server(snapshot_path, log_path, "and in"s);
+        server.AddDocument(30, texts[3], DocumentStatus::ACTUAL, { 4 });
+        server.Sync();
+        mutex synced_mutex;
+        vector<pair<string, uintmax_t>> synced;
+        SetFileSyncObserver([&](const string& path) {
+            lock_guard guard(synced_mutex);
+            synced.push_back({ path, filesystem::file_size(log_path) });
+        });
+        server.Checkpoint();
+        SetFileSyncObserver(nullptr);
+        ASSERT_EQUAL(synced.size(), 3u);
+        ASSERT_EQUAL(synced[0].first, snapshot_path + ".tmp"s);
+        ASSERT_EQUAL(synced[1].first, directory.string());
+        ASSERT_EQUAL(synced[2].first, log_path);
+        ASSERT(synced[0].second > 0 && synced[1].second > 0);
+        ASSERT_EQUAL(synced[2].second, 0u);
+    }
+
+    filesystem::remove(snapshot_path);
+    filesystem::remove(log_path);
+    filesystem::remove(log_copy);
+}
+
+// Конвейер загрузки корпуса добавляет те же документы, что и последовательный цикл, и останавливается на ошибке
+void TestIngestPipeline() {
+    {
+        const DocumentInput short_record = ParseDocumentRecord("12\tcurly cat"sv);
+        ASSERT_EQUAL(short_record.id, 12);
+        ASSERT_EQUAL(short_record.text, "curly cat"sv);
+        ASSERT(short_record.status == DocumentStatus::ACTUAL && short_record.ratings.empty());
+        const DocumentInput full_record = ParseDocumentRecord("7\t2\t-1 5\tnasty\tdog"sv);
+        ASSERT_EQUAL(full_record.id, 7);
+        ASSERT(full_record.status == DocumentStatus::BANNED);
+        ASSERT(full_record.ratings == vector<int>({ -1, 5 }));
+        ASSERT_EQUAL(full_record.text, "nasty\tdog"sv);
+        for (const string_view invalid : { "cat"sv, "x\tcat"sv, "1\t9\t\tcat"sv, "1\t0\tcat"sv }) {
+            bool thrown = false;
+            try {
+                ParseDocumentRecord(invalid);
+            }
+            catch (const invalid_argument&) {
+                thrown = true;
+            }
+            ASSERT(thrown);
+        }
+    }
+
+    mt19937 generator(17);
+    const vector<string> dictionary = GenerateDictionary(generator, 300, 7);
+    SearchServer expected(dictionary[0]);
+    string corpus;
+    for (int id = 0; id < 2000; ++id) {
+        // Очень длинные строки больше блока чтения
+        const string text = GenerateQuery(generator, dictionary, id % 100 == 0 ? 200 : 1 + id % 20);
+        const DocumentStatus status = id % 3 == 0 ? DocumentStatus::IRRELEVANT : DocumentStatus::ACTUAL;
+        if (id % 2 == 0) {
+            corpus += to_string(id) + "\t"s + text + "\n"s;
+            expected.AddDocument(id, text, DocumentStatus::ACTUAL, {});
+        }
+        else {
+            corpus += to_string(id) + "\t"s + to_string(static_cast<int>(status)) + "\t"s + to_string(id % 9) + " 4\t"s + text + "\r\n\n"s;
+            expected.AddDocument(id, text, status, { id % 9, 4 });
+        }
+    }
+    // Последняя строка без перевода строки
+    corpus += "5000\t"s + dictionary[1];
+    expected.AddDocument(5000, dictionary[1], DocumentStatus::ACTUAL, {});
+
+    const auto check = [&](const SearchServer& server) {
+        ASSERT_EQUAL(server.GetDocumentCount(), expected.GetDocumentCount());
+        for (int i = 0; i < 30; ++i) {
+            const string query = GenerateQuery(generator, dictionary, 1 + i % 4, 0.2);
+            for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT }) {
+                const auto found = server.FindTopDocuments(query, status, 10);
+                const auto expected_found = expected.FindTopDocuments(query, status, 10);
+                ASSERT_EQUAL(found.size(), expected_found.size());
+                for (size_t j = 0; j < found.size(); ++j) {
+                    ASSERT_EQUAL(found[j].id, expected_found[j].id);
+                    ASSERT_EQUAL(found[j].relevance, expected_found[j].relevance);
+                    ASSERT_EQUAL(found[j].rating, expected_found[j].rating);
+                }
+            }
+        }
+    };
+    for (const IngestOptions options : { IngestOptions{ 256, 7, 1 }, IngestOptions{ 4096, 100, 3 }, IngestOptions{} }) {
+        SearchServer server(dictionary[0]);
+        istringstream input(corpus);
+        ASSERT_EQUAL(IngestCorpus(server, input, options), 2001u);
+        check(server);
+    }
+
+    const string path = (filesystem::temp_directory_path() / "search_server_test.corpus"s).string();
+    {
+        ofstream output(path, ios::binary);
+        output << corpus;
+    }
+    SearchServer file_server(dictionary[0]);
+    ASSERT_EQUAL(IngestCorpusFile(file_server, path, { 1000, 64, 2 }), 2001u);
+    check(file_server);
+    filesystem::remove(path);
+
+    // Ошибка в записи и повтор id останавливают все стадии
+    for (const string& invalid_corpus : { corpus + "\nbad\trecord\n"s + corpus, corpus + "\n"s + corpus }) {
+        SearchServer server(dictionary[0]);
+        istringstream input(invalid_corpus);
+        bool thrown = false;
+        try {
+            IngestCorpus(server, input, { 512, 50, 2 });
+        }
+        catch (const invalid_argument&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+        ASSERT(server.GetDocumentCount() <= 2001);
+    }
+}
+
+// Слова словаря хранятся в арене: представления не меняются при добавлении, а копия сервера не зависит от оригинала
+void TestTermDictionary() {
+    {
+        StringArena arena;
+        const string_view first = arena.Store("curly"sv);
+        const string long_word(StringArena::CHUNK_SIZE, 'x');
+        ASSERT_EQUAL(arena.Store(long_word), string_view(long_word));
+        vector<string_view> stored;
+        for (int i = 0; i < 20000; ++i) {
+            stored.push_back(arena.Store(to_string(i)));
+        }
+        ASSERT_EQUAL(first, "curly"sv);
+        ASSERT_EQUAL(stored[12345], "12345"sv);
+        ASSERT(arena.GetAllocatedSize() < arena.GetStoredSize() + 2 * StringArena::CHUNK_SIZE);
+    }
+    {
+        TermDictionary dictionary;
+        ASSERT_EQUAL(dictionary.Intern("cat"sv), 0u);
+        ASSERT_EQUAL(dictionary.Intern("dog"sv), 1u);
+        ASSERT_EQUAL(dictionary.Intern("cat"sv), 0u);
+        ASSERT_EQUAL(dictionary.Find("dog"sv), 1u);
+        ASSERT_EQUAL(dictionary.Find("rat"sv), TermDictionary::NO_TERM);
+        const TermDictionary copy = dictionary;
+        ASSERT_EQUAL(copy.size(), 2u);
+        ASSERT_EQUAL(copy[1], "dog"sv);
+        ASSERT(copy[1].data() != dictionary[1].data());
+
+        // Словарь из сохранённой таблицы находит слова без повторного хеширования, а чужая таблица отвергается
+        TermDictionary restored(dictionary.GetWords(), dictionary.GetHashes(), dictionary.GetSlots());
+        ASSERT_EQUAL(restored.Find("dog"sv), 1u);
+        ASSERT_EQUAL(restored.Find("rat"sv), TermDictionary::NO_TERM);
+        ASSERT_EQUAL(restored.Intern("rat"sv), 2u);
+        ASSERT_EQUAL(restored.Find("cat"sv), 0u);
+        // Число слотов не степень двойки или таблица без свободного слота, на котором заканчивается поиск
+        for (const MappedVector<uint32_t>& slots : { MappedVector<uint32_t>{ 0, 1, TermDictionary::NO_TERM }, MappedVector<uint32_t>{ 0, 1, 0, 1 } }) {
+            bool thrown = false;
+            try {
+                TermDictionary(dictionary.GetWords(), dictionary.GetHashes(), slots);
+            }
+            catch (const invalid_argument&) {
+                thrown = true;
+            }
+            ASSERT(thrown);
+        }
+    }
+
+    SearchServer copy;
+    {
+        SearchServer server("and with"s);
+        server.AddDocument(1, "fluffy cat and collar"s, DocumentStatus::ACTUAL, { 1 });
+        server.AddDocument(2, "groomed dog with collar"s, DocumentStatus::ACTUAL, { 2 });
+        copy = server;
+    }
+    copy.AddDocument(3, "fluffy starling"s, DocumentStatus::ACTUAL, { 3 });
+    ASSERT_EQUAL(copy.FindTopDocuments("fluffy collar"s).size(), 3u);
+    vector<string_view> words;
+    for (const auto& [word, term_freq] : copy.GetWordFrequencies(2)) {
+        words.push_back(word);
+    }
+    // Слова идут в алфавитном порядке
+    ASSERT(words == vector<string_view>({ "collar"sv, "dog"sv, "groomed"sv }));
+
+    // Найденные слова ссылаются на словарь сервера, а не на текст запроса
+    vector<string_view> matched;
+    {
+        string query = "collar fluffy"s;
+        matched = get<0>(copy.MatchDocument(query, 1));
+        const auto [matched_par, status] = copy.MatchDocument(execution::par, query, 1);
+        ASSERT(matched_par == matched);
+        query.assign(query.size(), '-');
+    }
+    ASSERT(matched == vector<string_view>({ "collar"sv, "fluffy"sv }));
+}
+
+// Проверка индекса id документов: копии независимы, перемещённый индекс пуст
+void TestDocumentIds() {
+    DocumentIds ids;
+    ASSERT_EQUAL(ids.size(), 0u);
+    ASSERT(ids.begin() == ids.end());
+    ASSERT_EQUAL(ids.Find(1), DocumentIds::NO_ORDINAL);
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT(ids.Add(999 - i, i));
+    }
+    ASSERT(!ids.Add(5, 1000));
+    ASSERT_EQUAL(ids.At(5), 994);
+    ASSERT(ids.Remove(5));
+    ASSERT(!ids.Remove(5));
+    ASSERT(!ids.Contains(5));
+    bool thrown = false;
+    try {
+        ids.At(5);
+    }
+    catch (const out_of_range&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL(*ids.begin(), 0);
+    ASSERT(is_sorted(ids.begin(), ids.end()));
+
+    DocumentIds copy = ids;
+    copy.Add(5, 1000);
+    ASSERT(!ids.Contains(5));
+    ASSERT_EQUAL(copy.size(), 1000u);
+    DocumentIds moved = move(copy);
+    ASSERT_EQUAL(moved.At(5), 1000);
+    ASSERT_EQUAL(copy.size(), 0u);
+    ASSERT(copy.Add(5, 0));
+    ids = moved;
+    ASSERT_EQUAL(ids.size(), 1000u);
+
+    SearchServer server("and with"s);
+    server.AddDocument(3, "fluffy cat"s, DocumentStatus::ACTUAL, { 1 });
+    server.AddDocument(1, "groomed dog"s, DocumentStatus::ACTUAL, { 2 });
+    server.AddDocument(2, "fluffy dog"s, DocumentStatus::ACTUAL, { 3 });
+    server.RemoveDocument(1);
+    const SearchServer server_copy = server;
+    server.RemoveDocument(2);
+    ASSERT(vector<int>(server_copy.begin(), server_copy.end()) == vector<int>({ 2, 3 }));
+    ASSERT(vector<int>(server.begin(), server.end()) == vector<int>({ 3 }));
+    thrown = false;
+    try {
+        server.AddDocuments({ { 4, "cat"sv, DocumentStatus::ACTUAL, {} }, { 4, "dog"sv, DocumentStatus::ACTUAL, {} } });
+    }
+    catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL(server.GetDocumentCount(), 1);
+}
+
+// Проверка поиска с QueryContext: результаты как у обычного поиска, повторные запросы не выделяют память
+void TestQueryContext() {
+    SearchServer server("and with extraordinarily"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, { 5, -12, 2, 1 });
+    server.AddDocument(4, "groomed starling evgeny"s, DocumentStatus::BANNED, { 9 });
+    server.AddDocument(5, "extraordinarily fluffy cat with incomprehensibly long whiskers"s, DocumentStatus::ACTUAL, { 1 });
+    // Слова длиннее буфера короткой строки проверяют, что поиск стоп-слов не создаёт std::string
+    const vector<string> queries = { "fluffy groomed cat"s, "-collar cat dog cat"s,
+        "incomprehensibly extraordinarily whiskers"s, "starling -cat"s, "unknown"s };
+    const auto is_odd = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 1;
+    };
+    const auto same_documents = [](const vector<Document>& lhs, const vector<Document>& rhs) {
+        return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document& l, const Document& r) {
+            return l.id == r.id && l.relevance == r.relevance && l.rating == r.rating;
+            });
+    };
+
+    QueryContext context;
+    size_t expected_found = 0;
+    for (const string& query : queries) {
+        ASSERT(same_documents(server.FindTopDocuments(context, query), server.FindTopDocuments(query)));
+        ASSERT(same_documents(server.FindTopDocuments(context, query, DocumentStatus::BANNED), server.FindTopDocuments(query, DocumentStatus::BANNED)));
+        ASSERT(same_documents(server.FindTopDocuments(context, query, is_odd, 1), server.FindTopDocuments(query, is_odd, 1)));
+        expected_found += server.FindTopDocuments(query).size() + server.FindTopDocuments(query, DocumentStatus::BANNED).size()
+            + server.FindTopDocuments(query, is_odd, 1).size();
+    }
+
+    const size_t allocations = allocation_count;
+    size_t found = 0;
+    for (int i = 0; i < 10; ++i) {
+        for (const string& query : queries) {
+            found += server.FindTopDocuments(context, query).size();
+            found += server.FindTopDocuments(context, query, DocumentStatus::BANNED).size();
+            found += server.FindTopDocuments(context, query, is_odd, 1).size();
+        }
+    }
+    const size_t query_allocations = allocation_count - allocations;
+    ASSERT_EQUAL(query_allocations, 0u);
+    ASSERT_EQUAL(found, 10 * expected_found);
+}
+
+// Проверка разбиения на слова по блокам: совпадает с побайтовым разбиением на любых границах блоков
+void TestSplitIntoValidWords() {
+    const auto split_bytewise = [](string_view text, vector<string_view>& words) {
+        words.clear();
+        bool valid = true;
+        size_t word_begin = string_view::npos;
+        for (size_t i = 0; i <= text.size(); ++i) {
+            if (i == text.size() || text[i] == ' ') {
+                if (word_begin != string_view::npos) {
+                    words.push_back(text.substr(word_begin, i - word_begin));
+                    word_begin = string_view::npos;
+                }
+                continue;
+            }
+            valid = valid && static_cast<unsigned char>(text[i]) >= 0x20;
+            if (word_begin == string_view::npos) {
+                word_begin = i;
+            }
+        }
+        return valid;
+    };
+
+    vector<string_view> words;
+    ASSERT(SplitIntoValidWords(""sv, words));
+    ASSERT(words.empty());
+    ASSERT(SplitIntoValidWords("   "sv, words));
+    ASSERT(words.empty());
+    ASSERT(SplitIntoValidWords("  fluffy  cat "sv, words));
+    ASSERT(words == vector<string_view>({ "fluffy"sv, "cat"sv }));
+    // Байты от 0x80 не управляющие символы
+    ASSERT(SplitIntoValidWords("\xD0\xBA\xD0\xBE\xD1\x82 cat"sv, words));
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT(!SplitIntoValidWords("cat\tdog"sv, words));
+    ASSERT(!SplitIntoValidWords("cat\x1F"sv, words));
+    ASSERT(SplitIntoValidWords("cat\x20\x7F"sv, words));
+
+    mt19937 generator(17);
+    const string alphabet = "  ab\x01\x1F\x7F\x80\xE0"s;
+    vector<string_view> expected;
+    for (int i = 0; i < 2000; ++i) {
+        string text(uniform_int_distribution<size_t>(0, 100)(generator), ' ');
+        for (char& c : text) {
+            // Управляющие символы редки, чтобы встречались и корректные тексты
+            c = alphabet[uniform_int_distribution<size_t>(0, i % 2 == 0 ? 3 : alphabet.size() - 1)(generator)];
+        }
+        const bool valid = split_bytewise(text, expected);
+        ASSERT_EQUAL(SplitIntoValidWords(text, words), valid);
+        ASSERT(words == expected);
+        ASSERT(SplitIntoWords(text) == expected);
+    }
+}
+
+// Проверка фильтра стоп-слов: находит каждое стоп-слово и только их
+void TestStopWordFilter() {
+    const StopWordFilter empty;
+    ASSERT(!empty.Contains("and"sv));
+    ASSERT(!empty.Contains(""sv));
+
+    const StopWordFilter filter(StringSet({ "and"s, "with"s, "in"s, "a"s }));
+    ASSERT(filter.Contains("and"sv));
+    ASSERT(filter.Contains("a"sv));
+    ASSERT(!filter.Contains("an"sv));
+    ASSERT(!filter.Contains("andd"sv));
+    ASSERT(!filter.Contains(""sv));
+    ASSERT(vector<string>(filter.begin(), filter.end()) == vector<string>({ "a"s, "and"s, "in"s, "with"s }));
+
+    mt19937 generator(19);
+    StringSet words;
+    while (words.size() < 20000) {
+        words.insert(GenerateWord(generator, 12));
+    }
+    StopWordFilter large(words);
+    const StopWordFilter copy = large;
+    large = StopWordFilter();
+    ASSERT_EQUAL(copy.size(), words.size());
+    for (const string& word : words) {
+        ASSERT(copy.Contains(word));
+        ASSERT(!copy.Contains(word + "#"s));
+    }
+    for (int i = 0; i < 20000; ++i) {
+        const string word = GenerateWord(generator, 16);
+        ASSERT_EQUAL(copy.Contains(word), words.count(word) > 0);
+    }
+
+    // Стоп-слова восстанавливаются из снимка
+    const string path = (filesystem::temp_directory_path() / "search_server_test.stop_words"s).string();
+    SearchServer server("with and"s);
+    server.AddDocument(1, "cat with collar and bow"s, DocumentStatus::ACTUAL, { 1 });
+    server.SaveSnapshot(path);
+    SearchServer loaded = SearchServer::LoadSnapshot(path);
+    filesystem::remove(path);
+    loaded.AddDocument(2, "dog with and"s, DocumentStatus::ACTUAL, { 2 });
+    ASSERT(loaded.FindTopDocuments("with and"s).empty());
+    ASSERT_EQUAL(loaded.FindTopDocuments("dog"s).size(), 1u);
+}
+
 // --------- Окончание модульных тестов поисковой системы -----------
 
 
@@ -538,6 +2142,31 @@ void TestSearchServer() {
     RUN_TEST(TestProcessQueries);
     RUN_TEST(TestRemoveDocuments);
     RUN_TEST(TestMatchDocument);
+    RUN_TEST(TestWordFrequencies);
+    RUN_TEST(TestCompressedPostingList);
+    RUN_TEST(TestTermFreqPrecision);
+    RUN_TEST(TestDocumentOrdinals);
+    RUN_TEST(TestInverseDocumentFreqCache);
+    RUN_TEST(TestTopDocumentCount);
+    RUN_TEST(TestWandSearch);
+    RUN_TEST(TestScoreAccumulator);
+    RUN_TEST(TestMinusWordsExclusion);
+    RUN_TEST(TestStatusBitmaps);
+    RUN_TEST(TestDocumentFilter);
+    RUN_TEST(TestForwardIndex);
+    RUN_TEST(TestTombstoneCompaction);
+    RUN_TEST(TestAddDocumentsBatch);
+    RUN_TEST(TestIndexSegments);
+    RUN_TEST(TestConcurrentSearchServer);
+    RUN_TEST(TestShardedSearchServer);
+    RUN_TEST(TestIndexSnapshot);
+    RUN_TEST(TestWriteAheadLog);
+    RUN_TEST(TestIngestPipeline);
+    RUN_TEST(TestTermDictionary);
+    RUN_TEST(TestDocumentIds);
+    RUN_TEST(TestQueryContext);
+    RUN_TEST(TestSplitIntoValidWords);
+    RUN_TEST(TestStopWordFilter);
 }
 
 
@@ -141,4 +141,29 @@ void TestAverageRating();
 void TestRemoveDuplicates();
 void TestProcessQueries();
 void TestRemoveDocuments();
-void TestMatchDocument();
\ No newline at end of file
+void TestMatchDocument();
+void TestWordFrequencies();
+void TestCompressedPostingList();
+void TestTermFreqPrecision();
+void TestDocumentOrdinals();
+void TestInverseDocumentFreqCache();
+void TestTopDocumentCount();
+void TestWandSearch();
+void TestScoreAccumulator();
+void TestMinusWordsExclusion();
+void TestStatusBitmaps();
+void TestDocumentFilter();
+void TestForwardIndex();
+void TestTombstoneCompaction();
+void TestAddDocumentsBatch();
+void TestIndexSegments();
+void TestConcurrentSearchServer();
+void TestShardedSearchServer();
+void TestIndexSnapshot();
+void TestWriteAheadLog();
+void TestIngestPipeline();
+void TestTermDictionary();
+void TestDocumentIds();
+void TestQueryContext();
+void TestSplitIntoValidWords();
+void TestStopWordFilter();
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include "write_ahead_log.h"
+#include "snapshot_file.h"
+#include "file_sync.h"
+
+using namespace std::string_literals;
+
+
+namespace {
+
+    template <typename T>
+    void AppendValue(std::vector<char>& bytes, T value) {
+        const char* data = reinterpret_cast<const char*>(&value);
+        bytes.insert(bytes.end(), data, data + sizeof(value));
+    }
+
+    // Reads a value at pos and moves pos past it, false if the payload is too short
+    template <typename T>
+    bool ReadValue(const std::vector<char>& bytes, size_t& pos, T& value) {
+        if (bytes.size() - pos < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, bytes.data() + pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    }
+
+}
+
+
+WriteAheadLog::WriteAheadLog(const std::string& path, WriteAheadLogOptions options)
+    : path_(path)
+    , options_(options) {
+    if (options_.group_size == 0) {
+        options_.group_size = 1;
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    try {
+        Sync();
+    }
+    catch (const std::runtime_error&) {
+    }
+    // The flusher may outlive the file when Truncate failed to reopen it
+    StopFlusher();
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+void WriteAheadLog::AppendAddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    BeginRecord(LogRecordType::ADD_DOCUMENT, document_id);
+    AppendValue(record_, static_cast<int32_t>(status));
+    AppendValue(record_, static_cast<uint32_t>(ratings.size()));
+    for (int rating : ratings) {
+        AppendValue(record_, static_cast<int32_t>(rating));
+    }
+    AppendValue(record_, static_cast<uint32_t>(document.size()));
+    record_.insert(record_.end(), document.begin(), document.end());
+    EndRecord();
+}
+
+void WriteAheadLog::AppendRemoveDocument(int document_id) {
+    BeginRecord(LogRecordType::REMOVE_DOCUMENT, document_id);
+    EndRecord();
+}
+
+void WriteAheadLog::Sync() {
+    if (file_ == nullptr) {
+        return;
+    }
+    std::unique_lock lock(mutex_);
+    if (pending_records_ > 0) {
+        HandOff(lock);
+    }
+    WaitForFlusher(lock);
+}
+
+void WriteAheadLog::Truncate() {
+    std::unique_lock lock(mutex_);
+    if (file_ != nullptr) {
+        WaitForFlusher(lock);
+    }
+    pending_.clear();
+    pending_records_ = 0;
+    Open(0);
+    // The flusher is idle and nothing is pending, so the cut file is synced here
+    if (options_.sync && !SyncFile(file_, path_)) {
+        throw std::runtime_error("Cannot write log "s + path_);
+    }
+}
+
+bool WriteAheadLog::ReadRecord(std::istream& input, uint64_t file_size, std::vector<char>& buffer, LogRecord& record) {
+    RecordHeader header;
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+    // A torn header may claim any size, so it is checked before anything is allocated for it
+    const uint64_t position = static_cast<uint64_t>(input.tellg());
+    if (header.size > MAX_RECORD_SIZE || header.size > file_size - std::min(position, file_size)) {
+        return false;
+    }
+    buffer.resize(header.size);
+    if (!input.read(buffer.data(), header.size)
+        || SnapshotFormat::ComputeChecksum(buffer.data(), buffer.size()) != header.checksum) {
+        return false;
+    }
+
+    size_t pos = 0;
+    uint8_t type = 0;
+    int32_t document_id = 0;
+    if (!ReadValue(buffer, pos, type) || !ReadValue(buffer, pos, document_id)) {
+        return false;
+    }
+    record.type = static_cast<LogRecordType>(type);
+    record.document_id = document_id;
+    record.ratings.clear();
+    record.text.clear();
+    if (record.type == LogRecordType::REMOVE_DOCUMENT) {
+        return pos == buffer.size();
+    }
+    if (record.type != LogRecordType::ADD_DOCUMENT) {
+        return false;
+    }
+
+    int32_t status = 0;
+    uint32_t rating_count = 0;
+    if (!ReadValue(buffer, pos, status) || !ReadValue(buffer, pos, rating_count)
+        || status < 0 || status >= static_cast<int32_t>(DOCUMENT_STATUS_COUNT)) {
+        return false;
+    }
+    record.status = static_cast<DocumentStatus>(status);
+    for (uint32_t i = 0; i < rating_count; ++i) {
+        int32_t rating = 0;
+        if (!ReadValue(buffer, pos, rating)) {
+            return false;
+        }
+        record.ratings.push_back(rating);
+    }
+    uint32_t text_size = 0;
+    if (!ReadValue(buffer, pos, text_size) || buffer.size() - pos != text_size) {
+        return false;
+    }
+    record.text.assign(buffer.data() + pos, text_size);
+    return true;
+}
+
+void WriteAheadLog::Open(uint64_t valid_size) {
+    if (file_ != nullptr) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    std::error_code error;
+    if (std::filesystem::exists(path_, error) && std::filesystem::file_size(path_, error) != valid_size) {
+        std::filesystem::resize_file(path_, valid_size, error);
+    }
+    if (error) {
+        throw std::runtime_error("Cannot open log "s + path_);
+    }
+    file_ = std::fopen(path_.c_str(), "ab");
+    if (file_ == nullptr) {
+        throw std::runtime_error("Cannot open log "s + path_);
+    }
+    if (!flusher_.joinable()) {
+        flusher_ = std::thread([this] {
+            RunFlusher();
+        });
+    }
+}
+
+void WriteAheadLog::BeginRecord(LogRecordType type, int document_id) {
+    if (file_ == nullptr) {
+        Replay([](const LogRecord&) {});
+    }
+    record_.resize(sizeof(RecordHeader));
+    AppendValue(record_, static_cast<uint8_t>(type));
+    AppendValue(record_, static_cast<int32_t>(document_id));
+}
+
+void WriteAheadLog::EndRecord() {
+    const size_t size = record_.size() - sizeof(RecordHeader);
+    if (size > MAX_RECORD_SIZE) {
+        throw std::invalid_argument("Log record is too large"s);
+    }
+    RecordHeader header = {};
+    header.size = static_cast<uint32_t>(size);
+    header.checksum = SnapshotFormat::ComputeChecksum(record_.data() + sizeof(RecordHeader), size);
+    std::memcpy(record_.data(), &header, sizeof(header));
+
+    std::unique_lock lock(mutex_);
+    pending_.insert(pending_.end(), record_.begin(), record_.end());
+    if (pending_records_++ == 0) {
+        // Starts the max_delay timer of the flusher
+        pending_since_ = std::chrono::steady_clock::now();
+        flusher_wakeup_.notify_one();
+    }
+    // While the flusher is busy the group keeps growing, up to the limit of pending groups
+    if (pending_records_ >= options_.group_size
+        && (!flushing_busy_ || pending_records_ >= options_.group_size * options_.max_pending_groups)) {
+        HandOff(lock);
+    }
+}
+
+void WriteAheadLog::HandOff(std::unique_lock<std::mutex>& lock) {
+    WaitForFlusher(lock);
+    TakePending();
+    flusher_wakeup_.notify_one();
+}
+
+void WriteAheadLog::TakePending() {
+    std::swap(pending_, flushing_);
+    pending_.clear();
+    pending_records_ = 0;
+    flushing_busy_ = true;
+}
+
+void WriteAheadLog::WaitForFlusher(std::unique_lock<std::mutex>& lock) {
+    flush_done_.wait(lock, [this] {
+        return !flushing_busy_;
+    });
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void WriteAheadLog::RunFlusher() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        flusher_wakeup_.wait(lock, [this] {
+            return flushing_busy_ || stop_ || pending_records_ > 0;
+        });
+        if (!flushing_busy_ && !stop_) {
+            // Records that do not fill a group are taken by the flusher itself once the oldest has waited max_delay
+            const bool handed_off = flusher_wakeup_.wait_until(lock, pending_since_ + options_.max_delay, [this] {
+                return flushing_busy_ || stop_ || pending_records_ == 0;
+            });
+            if (!handed_off) {
+                TakePending();
+            }
+        }
+        if (!flushing_busy_) {
+            if (stop_) {
+                return;
+            }
+            continue;
+        }
+        // The appending thread does not touch flushing_ or file_ until flushing_busy_ is reset
+        lock.unlock();
+        bool written = std::fwrite(flushing_.data(), 1, flushing_.size(), file_) == flushing_.size() && std::fflush(file_) == 0;
+        if (written && options_.sync) {
+            written = SyncFile(file_, path_);
+        }
+        lock.lock();
+        if (!written && !error_) {
+            error_ = std::make_exception_ptr(std::runtime_error("Cannot write log "s + path_));
+        }
+        flushing_.clear();
+        flushing_busy_ = false;
+        flush_done_.notify_all();
+    }
+}
+
+void WriteAheadLog::StopFlusher() {
+    if (!flusher_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard guard(mutex_);
+        stop_ = true;
+    }
+    flusher_wakeup_.notify_one();
+    flusher_.join();
+}
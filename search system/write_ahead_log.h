@@ -0,0 +1,139 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+
+
+struct WriteAheadLogOptions {
+    // Records collected before they are handed to the flusher thread as one group
+    size_t group_size = 128;
+    // Without syncing a written group survives a crash of the process but not of the machine
+    bool sync = true;
+    // Appends wait for the flusher once this many groups are collected, so a slow disk holds ingestion back
+    size_t max_pending_groups = 8;
+    // A group that does not fill up is written once its oldest record has waited this long
+    std::chrono::milliseconds max_delay{ 10 };
+};
+
+enum class LogRecordType : uint8_t {
+    ADD_DOCUMENT = 1,
+    REMOVE_DOCUMENT = 2
+};
+
+// One index mutation, text and ratings are only set for ADD_DOCUMENT
+struct LogRecord {
+    LogRecordType type = LogRecordType::ADD_DOCUMENT;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    std::string text;
+};
+
+// Append-only file of index mutations with group commit. Appends only encode records into memory.
+// A flusher thread writes and syncs the collected records as one group while the next group is being
+// collected, so one fsync covers every record that arrived during the previous one. Each record carries
+// its size and an FNV-1a checksum of its contents, so a record torn by a crash ends the log instead of
+// being replayed. Records that are not written yet are lost on a crash. They reach the file once their
+// group fills up or max_delay after the first of them; Sync is the durability point and waits until
+// every appended record is written. Appends and Sync must come from one thread at a time.
+class WriteAheadLog {
+public:
+    explicit WriteAheadLog(const std::string& path, WriteAheadLogOptions options = {});
+    // Writes and syncs the pending records
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Calls function(const LogRecord&) for every record in the file in order and returns their count.
+    // A damaged tail is cut off. Must come before the first append, which otherwise does it itself.
+    template <typename Function>
+    size_t Replay(Function function);
+
+    // Throw std::runtime_error if a group cannot be written, std::invalid_argument if the record exceeds MAX_RECORD_SIZE
+    void AppendAddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void AppendRemoveDocument(int document_id);
+
+    void Sync();
+    // Drops every record, pending ones included
+    void Truncate();
+
+    // Larger sizes in a record header are taken for a torn header and end the log
+    static constexpr uint32_t MAX_RECORD_SIZE = 1u << 28;
+
+private:
+    struct RecordHeader {
+        uint32_t size;
+        uint32_t reserved;
+        uint64_t checksum;
+    };
+
+    std::string path_;
+    WriteAheadLogOptions options_;
+    std::FILE* file_ = nullptr;
+    // The record being encoded, moved to pending_ once it is complete
+    std::vector<char> record_;
+
+    // Guards the fields below, which the flusher thread shares with the appending one
+    std::mutex mutex_;
+    // Encoded records not handed to the flusher yet
+    std::vector<char> pending_;
+    size_t pending_records_ = 0;
+    std::chrono::steady_clock::time_point pending_since_;
+    std::condition_variable flusher_wakeup_;
+    std::condition_variable flush_done_;
+    std::vector<char> flushing_;
+    bool flushing_busy_ = false;
+    bool stop_ = false;
+    // Set instead of throwing on the flusher thread, rethrown by the next append or Sync
+    std::exception_ptr error_;
+    std::thread flusher_;
+
+    // Reads the next whole record of a file of file_size bytes, false at the end of the log or at a damaged record
+    static bool ReadRecord(std::istream& input, uint64_t file_size, std::vector<char>& buffer, LogRecord& record);
+    // Cuts the file to valid_size and opens it for appending
+    void Open(uint64_t valid_size);
+    // Reserves the header of record_, the payload is appended after it
+    void BeginRecord(LogRecordType type, int document_id);
+    void EndRecord();
+    // Hands the pending records to the flusher, waiting if it is still busy with an earlier group
+    void HandOff(std::unique_lock<std::mutex>& lock);
+    // Moves the pending records to flushing_, the flusher must be idle
+    void TakePending();
+    // Waits until the flusher is idle and rethrows its error
+    void WaitForFlusher(std::unique_lock<std::mutex>& lock);
+    void RunFlusher();
+    // Joins the flusher if it was started, whether or not the file is open
+    void StopFlusher();
+};
+
+template <typename Function>
+size_t WriteAheadLog::Replay(Function function) {
+    size_t count = 0;
+    uint64_t valid_size = 0;
+    {
+        std::ifstream input(path_, std::ios::binary | std::ios::ate);
+        const uint64_t file_size = input ? static_cast<uint64_t>(input.tellg()) : 0;
+        input.seekg(0);
+        std::vector<char> buffer;
+        LogRecord record;
+        while (input && ReadRecord(input, file_size, buffer, record)) {
+            function(static_cast<const LogRecord&>(record));
+            ++count;
+            valid_size = static_cast<uint64_t>(input.tellg());
+        }
+    }
+    Open(valid_size);
+    return count;
+}